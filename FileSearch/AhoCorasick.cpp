@@ -0,0 +1,115 @@
+
+#include "pch.h"
+#include "ahocorasick.h"
+
+AhoCorasick::AhoCorasick (const std::vector <std::basic_string <unsigned char>> & patterns)
+{
+	// column 0 is for the bytes of no pattern
+	uint16_t classes = 0;
+	for (auto & pattern : patterns)
+	{
+		for (auto c : pattern)
+		{
+			if (0 == m_class [c])
+				m_class [c] = ++classes;
+		}
+	}
+	m_columns = classes + 1;
+
+	size_t total = 1;
+	for (auto & pattern : patterns)
+		total += pattern.size ();
+	if (total > m_lMatchFlag / m_columns)
+		throw std::length_error ("too many content patterns");
+
+	// the trie, 0 marks missing children: the root is no one's child
+	m_delta.assign (m_columns, 0);
+	m_out.assign (1, m_lNone);
+	m_length.reserve (patterns.size ());
+
+	for (size_t i = 0; i < patterns.size (); i++)
+	{
+		m_length.push_back (static_cast <uint32_t> (patterns [i].size ()));
+		if (patterns [i].empty ())
+			continue;
+
+		uint32_t s = 0;
+		for (auto c : patterns [i])
+		{
+			uint32_t & next = m_delta [s * m_columns + m_class [c]];
+			if (0 == next)
+			{
+				next = static_cast <uint32_t> (m_out.size ());
+				m_out.push_back (m_lNone);
+				m_delta.resize (m_delta.size () + m_columns, 0);
+			}
+			s = m_delta [s * m_columns + m_class [c]];
+		}
+		if (m_lNone == m_out [s])
+			m_out [s] = static_cast <uint32_t> (i);
+	}
+
+	// States renumbered breadth first: the shallow ones, where a scan spends
+	// nearly all its time, end up next to each other in the table
+	size_t states = m_out.size ();
+	std::vector <uint32_t> order (1, 0);
+	order.reserve (states);
+	for (size_t i = 0; i < order.size (); i++)
+	{
+		for (size_t c = 0; c < m_columns; c++)
+		{
+			if (uint32_t t = m_delta [order [i] * m_columns + c])
+				order.push_back (t);
+		}
+	}
+
+	std::vector <uint32_t> rank (states);
+	for (size_t i = 0; i < states; i++)
+		rank [order [i]] = static_cast <uint32_t> (i);
+
+	std::vector <uint32_t> delta (states * m_columns, 0);
+	std::vector <uint32_t> out (states);
+	for (size_t i = 0; i < states; i++)
+	{
+		for (size_t c = 0; c < m_columns; c++)
+		{
+			if (uint32_t t = m_delta [order [i] * m_columns + c])
+				delta [i * m_columns + c] = rank [t];
+		}
+		out [i] = m_out [order [i]];
+	}
+	m_delta.swap (delta);
+	m_out.swap (out);
+
+	// Failure links in the same order. A missing child takes the transition
+	// of the failure state, whose row is complete by then as it is shallower.
+	// Missing children of the root stay 0, the root itself
+	std::vector <uint32_t> fail (states, 0);
+	m_next_out.assign (states, m_lNone);
+
+	for (size_t s = 1; s < states; s++)
+	{
+		uint32_t * row = m_delta.data () + s * m_columns;
+		const uint32_t * fail_row = m_delta.data () + static_cast <size_t> (fail [s]) * m_columns;
+		for (size_t c = 0; c < m_columns; c++)
+		{
+			if (0 == row [c])
+			{
+				row [c] = fail_row [c];
+				continue;
+			}
+
+			uint32_t t = row [c];
+			uint32_t f = fail_row [c];
+			fail [t] = f;
+			m_next_out [t] = (m_out [f] != m_lNone ? f : m_next_out [f]);
+		}
+	}
+
+	// state numbers to row offsets, flagged where patterns end
+	for (auto & next : m_delta)
+	{
+		bool match = (m_out [next] != m_lNone || m_next_out [next] != m_lNone);
+		next = static_cast <uint32_t> (next * m_columns) | (match ? m_lMatchFlag : 0);
+	}
+}
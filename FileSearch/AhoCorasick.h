@@ -0,0 +1,73 @@
+
+#pragma once
+
+// A match of one of the content patterns, the offset is of its first byte
+struct ContentMatch
+{
+	uint32_t pattern;
+	uint64_t offset;
+};
+
+// Aho-Corasick automaton of many patterns, built into a DFA, so a scan
+// makes one table lookup per byte of input whatever the number of
+// patterns. Bytes used in no pattern share one column of the table, which
+// so takes states x (distinct bytes + 1) entries. Entries hold the row of
+// the next state, with the top bit set on states some pattern ends in
+class AhoCorasick
+{
+	static constexpr uint32_t m_lMatchFlag = 0x80000000;
+	static constexpr uint32_t m_lNone = static_cast <uint32_t> (-1);
+
+	std::array <uint16_t, 256> m_class = {};	// column of each byte
+	size_t m_columns = 0;
+	std::vector <uint32_t> m_delta;
+
+	std::vector <uint32_t> m_out;				// pattern ending in the state
+	std::vector <uint32_t> m_next_out;			// next state along the failure links with a pattern
+	std::vector <uint32_t> m_length;			// of the patterns
+
+public:
+	// throws std::length_error when the table does not fit 2^31 entries.
+	// Of equal patterns only the first is reported
+	explicit AhoCorasick (const std::vector <std::basic_string <unsigned char>> & patterns);
+
+	// Scans the next block of a stream, state starts at 0 and offset is of
+	// the block in the stream. on_match (pattern, offset) returns false to
+	// stop the scan, then Scan returns false too
+	template <class F>
+	bool Scan (uint32_t & state, const unsigned char * data, size_t size, uint64_t offset, F && on_match) const
+	{
+		const uint32_t * delta = m_delta.data ();
+		const uint16_t * cls = m_class.data ();
+		uint32_t s = state;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			s = delta [(s & ~m_lMatchFlag) + cls [data [i]]];
+			if ((s & m_lMatchFlag) && !Report (s, offset + i + 1, on_match))
+			{
+				state = s;
+				return false;
+			}
+		}
+
+		state = s;
+		return true;
+	}
+
+private:
+	template <class F>
+	bool Report (uint32_t s, uint64_t end, F & on_match) const
+	{
+		uint32_t t = (s & ~m_lMatchFlag) / static_cast <uint32_t> (m_columns);
+		if (m_lNone == m_out [t])
+			t = m_next_out [t];
+
+		for (; t != m_lNone; t = m_next_out [t])
+		{
+			if (!on_match (m_out [t], end - m_length [m_out [t]]))
+				return false;
+		}
+		return true;
+	}
+};
@@ -0,0 +1,87 @@
+
+#pragma once
+
+// Blocking multi-producer multi-consumer queue of limited depth. Push waits
+// while the queue is full, so a fast producer can't get ahead of consumers
+// by more than the depth. Close wakes everybody: Pop then drains what is
+// left and returns false once the queue is empty
+template <class T>
+class BoundedQueue
+{
+	std::deque <T> m_items;
+	size_t m_capacity;
+	bool m_closed = false;
+
+	std::mutex m_lock;
+	std::condition_variable m_not_full;
+	std::condition_variable m_not_empty;
+
+public:
+	BoundedQueue (size_t capacity) :
+		m_capacity (0 == capacity ? 1 : capacity)
+	{
+	}
+
+	BoundedQueue (const BoundedQueue &) = delete;
+	BoundedQueue & operator = (const BoundedQueue &) = delete;
+
+	// false if the queue was closed and the item is dropped
+	bool Push (T item)
+	{
+		std::unique_lock <std::mutex> lk (m_lock);
+		m_not_full.wait (lk, [this] { return m_closed || m_items.size () < m_capacity; });
+		if (m_closed)
+			return false;
+
+		m_items.push_back (std::move (item));
+		lk.unlock ();
+		m_not_empty.notify_one ();
+		return true;
+	}
+
+	bool Pop (T & item)
+	{
+		std::unique_lock <std::mutex> lk (m_lock);
+		m_not_empty.wait (lk, [this] { return m_closed || !m_items.empty (); });
+		if (m_items.empty ())
+			return false;
+
+		item = std::move (m_items.front ());
+		m_items.pop_front ();
+		lk.unlock ();
+		m_not_full.notify_one ();
+		return true;
+	}
+
+	// waits for one item like Pop, then takes whatever else is queued up to
+	// max items in all. Consumers that work in batches get bigger ones when
+	// they fall behind, without waiting for a batch to fill up
+	bool Pop (std::vector <T> & items, size_t max)
+	{
+		items.clear ();
+
+		std::unique_lock <std::mutex> lk (m_lock);
+		m_not_empty.wait (lk, [this] { return m_closed || !m_items.empty (); });
+		if (m_items.empty ())
+			return false;
+
+		while (!m_items.empty () && items.size () < max)
+		{
+			items.push_back (std::move (m_items.front ()));
+			m_items.pop_front ();
+		}
+		lk.unlock ();
+		m_not_full.notify_all ();
+		return true;
+	}
+
+	void Close ()
+	{
+		{
+			std::lock_guard <std::mutex> lk (m_lock);
+			m_closed = true;
+		}
+		m_not_full.notify_all ();
+		m_not_empty.notify_all ();
+	}
+};
@@ -0,0 +1,153 @@
+
+#include "pch.h"
+#include "bufferpool.h"
+
+std::atomic <size_t> BufferPool::m_lMaxPooled = 256 * 1024 * 1024;
+BufferPool::Shared BufferPool::m_shared;
+std::atomic <size_t> BufferPool::m_pooled = 0;
+std::atomic <uint64_t> BufferPool::m_hits = 0;
+std::atomic <uint64_t> BufferPool::m_misses = 0;
+
+static const std::align_val_t alignment { 64 };
+
+size_t BufferPool::ClassOf (size_t size) noexcept
+{
+	size_t n = 0;
+	while ((m_lMinSize << n) < size)
+		n++;
+	return n;
+}
+
+BufferPool::ThreadCache & BufferPool::Cache () noexcept
+{
+	static thread_local ThreadCache cache;
+	return cache;
+}
+
+unsigned char * BufferPool::Allocate (size_t capacity)
+{
+	return static_cast <unsigned char *> (::operator new (capacity, alignment));
+}
+
+void BufferPool::Free (unsigned char * data) noexcept
+{
+	::operator delete (data, alignment);
+}
+
+BufferPool::Shared::~Shared ()
+{
+	for (auto & list : free)
+	{
+		for (auto data : list)
+			Free (data);
+	}
+}
+
+BufferPool::ThreadCache::~ThreadCache ()
+{
+	// an exiting thread hands its buffers over to the others
+	std::lock_guard <std::mutex> lk (m_shared.lock);
+	for (size_t n = 0; n < m_lClasses; n++)
+	{
+		for (auto data : free [n])
+		{
+			try
+			{
+				m_shared.free [n].push_back (data);
+			}
+			catch (...)
+			{
+				m_pooled -= m_lMinSize << n;
+				Free (data);
+			}
+		}
+	}
+}
+
+BufferPool::Buffer BufferPool::Get (size_t size)
+{
+	size = std::max (size, m_lMinSize);
+	if (size > m_lMaxSize)
+	{
+		m_misses++;
+		return Buffer (Allocate (size), size);
+	}
+
+	size_t n = ClassOf (size);
+	size_t capacity = m_lMinSize << n;
+	auto & cache = Cache ();
+	unsigned char * data = nullptr;
+
+	if (!cache.free [n].empty ())
+	{
+		data = cache.free [n].back ();
+		cache.free [n].pop_back ();
+	}
+	else
+	{
+		std::lock_guard <std::mutex> lk (m_shared.lock);
+		if (!m_shared.free [n].empty ())
+		{
+			data = m_shared.free [n].back ();
+			m_shared.free [n].pop_back ();
+		}
+	}
+
+	if (nullptr == data)
+	{
+		m_misses++;
+		return Buffer (Allocate (capacity), capacity);
+	}
+
+	m_hits++;
+	m_pooled -= capacity;
+	return Buffer (data, capacity);
+}
+
+void BufferPool::Return (unsigned char * data, size_t capacity) noexcept
+{
+	if (capacity > m_lMaxSize || m_pooled + capacity > m_lMaxPooled)
+	{
+		Free (data);
+		return;
+	}
+
+	size_t n = ClassOf (capacity);
+	m_pooled += capacity;
+	try
+	{
+		auto & cache = Cache ();
+		if (cache.free [n].size () < m_lThreadKeep)
+		{
+			cache.free [n].push_back (data);
+			return;
+		}
+
+		std::lock_guard <std::mutex> lk (m_shared.lock);
+		m_shared.free [n].push_back (data);
+	}
+	catch (...)
+	{
+		m_pooled -= capacity;
+		Free (data);
+	}
+}
+
+void BufferPool::Buffer::Release () noexcept
+{
+	if (nullptr == m_data)
+		return;
+
+	BufferPool::Return (m_data, m_capacity);
+	m_data = nullptr;
+	m_capacity = 0;
+}
+
+BufferPool::Stats BufferPool::GetStats () noexcept
+{
+	Stats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.pooled = m_pooled;
+	return stats;
+}
@@ -0,0 +1,103 @@
+
+#pragma once
+
+// Read buffers recycled instead of freed. Sizes are rounded up to powers of
+// two from m_lMinSize to m_lMaxSize, bigger buffers are not pooled. A thread
+// keeps a few free buffers of each size of its own and only goes to the
+// shared lists, under a lock, when it has none or too many. Free buffers
+// never hold more than m_lMaxPooled bytes altogether, a buffer returned
+// over the cap is freed. Buffers are aligned to a cache line and are not
+// zero-filled
+class BufferPool
+{
+public:
+	static const size_t m_lMinSize = 4 * 1024;
+	static const size_t m_lMaxSize = 16 * 1024 * 1024;
+	static std::atomic <size_t> m_lMaxPooled;
+
+	// a borrowed buffer, goes back to the pool when destroyed
+	class Buffer
+	{
+		unsigned char * m_data = nullptr;
+		size_t m_capacity = 0;
+
+		friend class BufferPool;
+		Buffer (unsigned char * data, size_t capacity) noexcept :
+			m_data (data),
+			m_capacity (capacity)
+		{}
+
+	public:
+		Buffer () = default;
+		~Buffer ()
+		{
+			Release ();
+		}
+
+		Buffer (Buffer && buffer) noexcept :
+			m_data (std::exchange (buffer.m_data, nullptr)),
+			m_capacity (std::exchange (buffer.m_capacity, 0))
+		{}
+		Buffer & operator = (Buffer && buffer) noexcept
+		{
+			if (this != &buffer)
+			{
+				Release ();
+				m_data = std::exchange (buffer.m_data, nullptr);
+				m_capacity = std::exchange (buffer.m_capacity, 0);
+			}
+			return *this;
+		}
+
+		inline unsigned char * data () const noexcept
+		{
+			return m_data;
+		}
+
+		inline size_t capacity () const noexcept
+		{
+			return m_capacity;
+		}
+
+		void Release () noexcept;
+	};
+
+	struct Stats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t pooled = 0;						// bytes in free buffers
+	};
+
+	// throws std::bad_alloc
+	static Buffer Get (size_t size);
+	static Stats GetStats () noexcept;
+
+private:
+	static const size_t m_lClasses = 13;		// 4 KB to 16 MB
+	static const size_t m_lThreadKeep = 4;		// free buffers of a size a thread keeps
+
+	struct Shared
+	{
+		std::mutex lock;
+		std::vector <unsigned char *> free [m_lClasses];
+		~Shared ();
+	};
+
+	struct ThreadCache
+	{
+		std::vector <unsigned char *> free [m_lClasses];
+		~ThreadCache ();
+	};
+
+	static Shared m_shared;
+	static std::atomic <size_t> m_pooled;
+	static std::atomic <uint64_t> m_hits;
+	static std::atomic <uint64_t> m_misses;
+
+	static size_t ClassOf (size_t size) noexcept;
+	static ThreadCache & Cache () noexcept;
+	static unsigned char * Allocate (size_t capacity);
+	static void Free (unsigned char * data) noexcept;
+	static void Return (unsigned char * data, size_t capacity) noexcept;
+};
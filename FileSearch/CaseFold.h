@@ -0,0 +1,65 @@
+
+#pragma once
+
+// Case folding for case-insensitive mask matching, done a symbol at a time
+// so nothing has to be lowercased into a copy first. ASCII goes through a
+// table, only other symbols take the locale-aware towlower
+struct AsciiFoldTable
+{
+	wchar_t lower [128] = {};
+
+	constexpr AsciiFoldTable ()
+	{
+		for (wchar_t c = 0; c < 128; c++)
+			lower [c] = (c >= L'A' && c <= L'Z') ? static_cast <wchar_t> (c + (L'a' - L'A')) : c;
+	}
+};
+
+inline constexpr AsciiFoldTable g_ascii_fold;
+
+inline wchar_t FoldCase (wchar_t c) noexcept
+{
+	if (static_cast <uint32_t> (c) < 128)
+		return g_ascii_fold.lower [c];
+	return static_cast <wchar_t> (std::towlower (c));
+}
+
+inline std::wstring FoldCase (std::wstring_view str)
+{
+	std::wstring folded (str);
+	for (auto & c : folded)
+		c = FoldCase (c);
+	return folded;
+}
+
+// hash and equality over folded symbols, for tables keyed by folded masks
+// and searched with names as they are
+struct FoldedHash
+{
+	using is_transparent = void;
+
+	size_t operator () (std::wstring_view str) const noexcept
+	{
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (auto c : str)
+			h = (h ^ static_cast <uint32_t> (FoldCase (c))) * 0x100000001b3ull;
+		return static_cast <size_t> (h);
+	}
+};
+
+struct FoldedEqual
+{
+	using is_transparent = void;
+
+	bool operator () (std::wstring_view s1, std::wstring_view s2) const noexcept
+	{
+		if (s1.size () != s2.size ())
+			return false;
+		for (size_t i = 0; i < s1.size (); i++)
+		{
+			if (FoldCase (s1 [i]) != FoldCase (s2 [i]))
+				return false;
+		}
+		return true;
+	}
+};
@@ -1,21 +1,70 @@
 #pragma once
 #include "File.h"
+#include "executor.h"
 
 class Comparer
 {
+public:
+	// what one stage of FindEqualFiles has done: files read, bytes read and
+	// candidates to be equal left after it
+	struct StageStats
+	{
+		const wchar_t * name;
+		size_t files = 0;
+		uintmax_t bytes = 0;
+		size_t left = 0;
+	};
+
+	static size_t m_lSampleSize;
+	static size_t m_lStreamChunkSize;
+	static size_t m_lMaxStreamFiles;		// bigger buckets are hashed
+
+private:
 	std::map <uintmax_t, ListOfFiles> & m_files;
 	bool m_find_all_hashes;
+	size_t m_io_threads;
 
 	struct Res
 	{
-		ListOfFiles equal;
+		std::list <ListOfFiles> equal;
 		ListOfFiles failed;
 	};
+	using ResultFunc = std::function <void (Res &&)>;
 
-	void BinaryCompare (File & f1, File & f2, std::promise <Res> p);
-	void HashCompare (ListOfFiles & files, std::promise <Res> p);
+	// file read scheduled for the I/O pool. With hash set the file is hashed
+	// before the task runs, small files next to each other in one batch
+	struct Read
+	{
+		File * file;
+		Executor::Task task;
+		bool hash = false;
+	};
+	std::vector <Read> m_reads;
+
+	// parts of a file sampled before whole files are read
+	enum class Sample
+	{
+		head, tail, middle
+	};
+	std::vector <StageStats> m_stats;
+	std::atomic <uintmax_t> m_stream_bytes = 0;
+
+	void StreamCompare (ListOfFiles & files, ResultFunc done);
+	void HashCompare (Executor & executor, ListOfFiles & files, ResultFunc done);
+	static Res GroupByHash (ListOfFiles & files);
+	void SubmitReads (Executor & executor);
+	static bool SampleOffset (Sample sample, uintmax_t size, uintmax_t & offset) noexcept;
+	void SplitBySample (Executor & executor, std::list <ListOfFiles> & buckets, ListOfFiles & failed, Sample sample, StageStats & stats);
 
 public:
-	Comparer (std::map <uintmax_t, ListOfFiles> & files, bool find_all_hashes);
+	// io_threads caps the number of files read at once, 0 means one per CPU core
+	Comparer (std::map <uintmax_t, ListOfFiles> & files, bool find_all_hashes, size_t io_threads);
+	// files of equal size are split by a hash of their first bytes, then of
+	// their last and middle ones, and only the candidates left are read whole
 	void FindEqualFiles (std::list <ListOfFiles> & equal, ListOfFiles & failed, std::function <void(const ListOfFiles &)> equal_callback);
-};
\ No newline at end of file
+
+	inline const std::vector <StageStats> & Stats () const noexcept
+	{
+		return m_stats;
+	}
+};
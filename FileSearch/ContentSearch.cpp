@@ -0,0 +1,263 @@
+
+#include "pch.h"
+#include "contentsearch.h"
+#include "cpufeatures.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+#define SEARCH_X86
+#endif
+
+#if defined (__GNUC__) || defined (__clang__)
+#define SEARCH_TARGET(isa) __attribute__ ((target (isa)))
+#else
+#define SEARCH_TARGET(isa)
+#endif
+
+static SearchKernel SelectSearchKernel () noexcept
+{
+	for (auto kernel : { SearchKernel::avx2, SearchKernel::sse2 })
+	{
+		if (ContentSearch::IsKernelSupported (kernel))
+			return kernel;
+	}
+	return SearchKernel::scalar;
+}
+
+std::atomic <SearchKernel> ContentSearch::m_kernel { SelectSearchKernel () };
+
+// candidates from the last positions of a block, too few for a vector step
+static size_t FindTail (const unsigned char * data, size_t size, size_t from, const unsigned char * pattern, size_t len) noexcept
+{
+	for (size_t i = from; i + len <= size; i++)
+	{
+		if (data [i] == pattern [0] && data [i + len - 1] == pattern [len - 1] && std::memcmp (data + i + 1, pattern + 1, len - 2) == 0)
+			return i;
+	}
+	return ContentSearch::npos;
+}
+
+#ifdef SEARCH_X86
+
+// patterns of 2 bytes and more
+SEARCH_TARGET ("sse2")
+static size_t FindSse2 (const unsigned char * data, size_t size, const unsigned char * pattern, size_t len) noexcept
+{
+	const __m128i first = _mm_set1_epi8 (static_cast <char> (pattern [0]));
+	const __m128i last = _mm_set1_epi8 (static_cast <char> (pattern [len - 1]));
+
+	size_t i = 0;
+	for (; i + len - 1 + 16 <= size; i += 16)
+	{
+		__m128i f = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + i));
+		__m128i l = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + i + len - 1));
+		unsigned mask = static_cast <unsigned> (_mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (f, first), _mm_cmpeq_epi8 (l, last))));
+
+		for (; mask != 0; mask &= mask - 1)
+		{
+			size_t pos = i + std::countr_zero (mask);
+			if (std::memcmp (data + pos + 1, pattern + 1, len - 2) == 0)
+				return pos;
+		}
+	}
+	return FindTail (data, size, i, pattern, len);
+}
+
+SEARCH_TARGET ("avx2")
+static size_t FindAvx2 (const unsigned char * data, size_t size, const unsigned char * pattern, size_t len) noexcept
+{
+	const __m256i first = _mm256_set1_epi8 (static_cast <char> (pattern [0]));
+	const __m256i last = _mm256_set1_epi8 (static_cast <char> (pattern [len - 1]));
+
+	size_t i = 0;
+	for (; i + len - 1 + 32 <= size; i += 32)
+	{
+		__m256i f = _mm256_loadu_si256 (reinterpret_cast <const __m256i *> (data + i));
+		__m256i l = _mm256_loadu_si256 (reinterpret_cast <const __m256i *> (data + i + len - 1));
+		unsigned mask = static_cast <unsigned> (_mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (f, first), _mm256_cmpeq_epi8 (l, last))));
+
+		for (; mask != 0; mask &= mask - 1)
+		{
+			size_t pos = i + std::countr_zero (mask);
+			if (std::memcmp (data + pos + 1, pattern + 1, len - 2) == 0)
+				return pos;
+		}
+	}
+	return FindTail (data, size, i, pattern, len);
+}
+
+#endif // SEARCH_X86
+
+ContentSearch::ContentSearch (std::basic_string_view <unsigned char> pattern)
+{
+	SetPattern (pattern);
+}
+
+ContentSearch::ContentSearch (const std::vector <std::basic_string <unsigned char>> & patterns, bool all_matches) :
+	m_all_matches (all_matches)
+{
+	if (1 == patterns.size () && !all_matches)
+		SetPattern (patterns.front ());
+	else if (!patterns.empty ())
+		m_automaton = std::make_shared <AhoCorasick> (patterns);
+}
+
+void ContentSearch::SetPattern (std::basic_string_view <unsigned char> pattern)
+{
+	m_pattern = pattern;
+
+	size_t len = m_pattern.size ();
+	if (len < 2)
+		return;
+
+	m_skip.fill (static_cast <uint32_t> (len));
+	for (size_t i = 0; i + 1 < len; i++)
+		m_skip [m_pattern [i]] = static_cast <uint32_t> (len - 1 - i);
+
+	m_horspool = (len > m_lMaxPrefilterSize);
+}
+
+SearchKernel ContentSearch::GetKernel () noexcept
+{
+	return m_kernel;
+}
+
+bool ContentSearch::SetKernel (SearchKernel kernel) noexcept
+{
+	if (!IsKernelSupported (kernel))
+		return false;
+	m_kernel = kernel;
+	return true;
+}
+
+bool ContentSearch::IsKernelSupported (SearchKernel kernel) noexcept
+{
+	switch (kernel)
+	{
+	case SearchKernel::scalar:
+		return true;
+#ifdef SEARCH_X86
+	case SearchKernel::sse2:
+		return GetCpuFeatures ().sse2;
+	case SearchKernel::avx2:
+		return GetCpuFeatures ().avx2;
+#endif
+	default:
+		return false;
+	}
+}
+
+size_t ContentSearch::Find (const unsigned char * data, size_t size) const noexcept
+{
+	size_t len = m_pattern.size ();
+	if (0 == len || size < len)
+		return npos;
+
+	if (1 == len)
+	{
+		auto ptr = static_cast <const unsigned char *> (std::memchr (data, m_pattern [0], size));
+		return (nullptr == ptr ? npos : static_cast <size_t> (ptr - data));
+	}
+
+	if (!m_horspool)
+	{
+		switch (m_kernel.load (std::memory_order_relaxed))
+		{
+#ifdef SEARCH_X86
+		case SearchKernel::sse2:
+			return FindSse2 (data, size, m_pattern.data (), len);
+		case SearchKernel::avx2:
+			return FindAvx2 (data, size, m_pattern.data (), len);
+#endif
+		default:
+			break;
+		}
+	}
+
+	return FindHorspool (data, size);
+}
+
+size_t ContentSearch::FindHorspool (const unsigned char * data, size_t size) const noexcept
+{
+	size_t len = m_pattern.size ();
+	const unsigned char * pattern = m_pattern.data ();
+	unsigned char last = pattern [len - 1];
+
+	for (size_t i = 0; i + len <= size; )
+	{
+		unsigned char c = data [i + len - 1];
+		if (c == last && std::memcmp (data + i, pattern, len - 1) == 0)
+			return i;
+		i += m_skip [c];
+	}
+	return npos;
+}
+
+ContentSearch::Stream::Stream (const ContentSearch & search, std::vector <ContentMatch> * matches) :
+	m_search (search),
+	m_matches (search.m_all_matches ? matches : nullptr)
+{
+	if (search.m_pattern.size () > 1)
+		m_joint.resize ((search.m_pattern.size () - 1) * 2);
+}
+
+bool ContentSearch::Stream::Feed (const unsigned char * data, size_t size)
+{
+	if (m_search.m_automaton != nullptr)
+	{
+		bool done = !m_search.m_automaton->Scan (m_state, data, size, m_offset, [this](uint32_t pattern, uint64_t offset)
+		{
+			m_found = true;
+			if (nullptr == m_matches)
+				return false;
+			m_matches->push_back ({ pattern, offset });
+			return m_matches->size () < m_lMaxMatches;
+		});
+		m_offset += size;
+		return done;
+	}
+
+	if (m_found || m_search.empty ())
+		return m_found;
+
+	size_t overlap = m_search.m_pattern.size () - 1;
+	unsigned char * joint = m_joint.data ();
+
+	// matches starting in the kept tail, the head of the block completes them
+	if (m_tail > 0)
+	{
+		size_t head = std::min (size, overlap);
+		std::memcpy (joint + m_tail, data, head);
+		m_found = (m_search.Find (joint, m_tail + head) != npos);
+	}
+	if (!m_found)
+		m_found = (m_search.Find (data, size) != npos);
+
+	if (m_found || 0 == overlap)
+		return m_found;
+
+	if (size >= overlap)
+	{
+		std::memcpy (joint, data + size - overlap, overlap);
+		m_tail = overlap;
+	}
+	else
+	{
+		size_t keep = std::min (m_tail + size, overlap) - size;
+		std::memmove (joint, joint + m_tail - keep, keep);
+		std::memcpy (joint + keep, data, size);
+		m_tail = keep + size;
+	}
+	return false;
+}
+
+// the automaton reports a match where it ends, a shorter pattern ending
+// first may start after a longer one ending later
+void ContentSearch::Stream::Finish ()
+{
+	if (nullptr == m_matches)
+		return;
+	std::sort (m_matches->begin (), m_matches->end (), [](const ContentMatch & m1, const ContentMatch & m2)
+	{
+		return m1.offset != m2.offset ? m1.offset < m2.offset : m1.pattern < m2.pattern;
+	});
+}
@@ -0,0 +1,99 @@
+
+#pragma once
+#include "ahocorasick.h"
+
+// First pass of the search for short patterns: positions where both the
+// first and the last byte of the pattern match, compared at 16 or 32
+// positions at once. The candidates are confirmed with memcmp
+enum class SearchKernel
+{
+	scalar,		// no first pass, Boyer-Moore-Horspool for any pattern
+	sse2,		// 16 positions per step
+	avx2		// 32 positions per step
+};
+
+// Substring search in file content. Patterns longer than
+// m_lMaxPrefilterSize go through Boyer-Moore-Horspool in any case, which
+// skips about the pattern length per step and beats a byte prefilter there.
+// Several patterns, or one whose every match is wanted, are compiled into
+// an Aho-Corasick automaton instead, which finds them all in one pass.
+// The object is read-only once made, so threads share one. Stream searches
+// a file given block by block
+class ContentSearch
+{
+	static const size_t m_lMaxPrefilterSize = 64;
+
+	std::basic_string <unsigned char> m_pattern;
+	std::array <uint32_t, 256> m_skip = {};		// Horspool shift by the last byte of a window
+	bool m_horspool = false;
+
+	std::shared_ptr <const AhoCorasick> m_automaton;
+	bool m_all_matches = false;
+
+	static std::atomic <SearchKernel> m_kernel;
+
+public:
+	static const size_t npos = static_cast <size_t> (-1);
+	static const size_t m_lMaxMatches = 1024;	// recorded per file
+
+	ContentSearch () = default;
+	explicit ContentSearch (std::basic_string_view <unsigned char> pattern);
+	// a file matches if any of the patterns is found. Throws
+	// std::length_error for more patterns than an automaton holds
+	ContentSearch (const std::vector <std::basic_string <unsigned char>> & patterns, bool all_matches);
+
+	inline bool empty () const noexcept
+	{
+		return m_pattern.empty () && nullptr == m_automaton;
+	}
+
+	// whether streams record the matches, not only find the first one
+	inline bool AllMatches () const noexcept
+	{
+		return m_all_matches;
+	}
+
+	// offset of the first match of a single pattern in the block or npos
+	size_t Find (const unsigned char * data, size_t size) const noexcept;
+
+	// kernel used by every search. The fastest one the CPU supports is
+	// selected at startup, SetKernel fails for unsupported ones
+	static SearchKernel GetKernel () noexcept;
+	static bool SetKernel (SearchKernel kernel) noexcept;
+	static bool IsKernelSupported (SearchKernel kernel) noexcept;
+
+	// The search in consecutive blocks of one file. A match may cross the
+	// border of two blocks: a single pattern keeps the last size - 1 bytes
+	// of a block and searches them once more together with the start of the
+	// next one, the automaton carries its state over
+	class Stream
+	{
+		const ContentSearch & m_search;
+		std::basic_string <unsigned char> m_joint;	// tail of the previous block, then the head of the next
+		size_t m_tail = 0;
+		bool m_found = false;
+
+		std::vector <ContentMatch> * m_matches;
+		uint32_t m_state = 0;
+		uint64_t m_offset = 0;
+
+	public:
+		// matches are added to the given list if the search wants them all
+		explicit Stream (const ContentSearch & search, std::vector <ContentMatch> * matches = nullptr);
+
+		// true when the rest of the file need not be fed: the pattern is
+		// found, or m_lMaxMatches of all matches are
+		bool Feed (const unsigned char * data, size_t size);
+		// puts the matches in the order of their offsets, once nothing more is fed
+		void Finish ();
+
+		inline bool Found () const noexcept
+		{
+			return m_found;
+		}
+	};
+
+private:
+	void SetPattern (std::basic_string_view <unsigned char> pattern);
+	size_t FindHorspool (const unsigned char * data, size_t size) const noexcept;
+};
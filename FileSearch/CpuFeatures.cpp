@@ -0,0 +1,84 @@
+
+#include "pch.h"
+#include "cpufeatures.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+
+static void CpuId (unsigned leaf, unsigned subleaf, unsigned regs [4]) noexcept
+{
+#ifdef _MSC_VER
+	int r [4] = {};
+	__cpuidex (r, static_cast <int> (leaf), static_cast <int> (subleaf));
+	for (size_t i = 0; i < 4; i++)
+		regs [i] = static_cast <unsigned> (r [i]);
+#else
+	__cpuid_count (leaf, subleaf, regs [0], regs [1], regs [2], regs [3]);
+#endif
+}
+
+// the OS saves the given parts of the register state on context switches
+static bool IsOsStateEnabled (unsigned long long mask) noexcept
+{
+	unsigned regs [4] = {};
+	CpuId (1, 0, regs);
+	if (0 == (regs [2] & (1u << 27)))		// OSXSAVE
+		return false;
+
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv (0);
+#else
+	unsigned lo = 0, hi = 0;
+	__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+	unsigned long long xcr0 = (static_cast <unsigned long long> (hi) << 32) | lo;
+#endif
+	return (xcr0 & mask) == mask;
+}
+
+static bool IsYmmEnabled () noexcept
+{
+	return IsOsStateEnabled (0x06);
+}
+
+// YMM state plus the opmask registers and the upper ZMM halves
+static bool IsZmmEnabled () noexcept
+{
+	return IsOsStateEnabled (0xE6);
+}
+
+static CpuFeatures DetectCpuFeatures () noexcept
+{
+	CpuFeatures cpu;
+
+	unsigned regs [4] = {};
+	CpuId (0, 0, regs);
+	unsigned max_leaf = regs [0];
+
+	CpuId (1, 0, regs);
+	cpu.sse2 = (regs [3] & (1u << 26)) != 0;
+	cpu.ssse3 = (regs [2] & (1u << 9)) != 0;
+	cpu.sse41 = (regs [2] & (1u << 19)) != 0;
+
+	unsigned leaf7 [4] = {};
+	if (max_leaf >= 7)
+		CpuId (7, 0, leaf7);
+	cpu.avx2 = (leaf7 [1] & (1u << 5)) != 0 && IsYmmEnabled ();
+	cpu.avx512f = (leaf7 [1] & (1u << 16)) != 0 && IsZmmEnabled ();
+	cpu.sha = (leaf7 [1] & (1u << 29)) != 0;
+
+	return cpu;
+}
+
+#else
+
+static CpuFeatures DetectCpuFeatures () noexcept
+{
+	return {};
+}
+
+#endif
+
+const CpuFeatures & GetCpuFeatures () noexcept
+{
+	static const CpuFeatures cpu = DetectCpuFeatures ();
+	return cpu;
+}
@@ -0,0 +1,17 @@
+
+#pragma once
+
+// Instruction set extensions of the CPU, detected once. The ones with wider
+// registers count only if the OS also saves those registers on context
+// switches. All false on other architectures
+struct CpuFeatures
+{
+	bool sse2 = false;
+	bool ssse3 = false;
+	bool sse41 = false;
+	bool avx2 = false;
+	bool avx512f = false;
+	bool sha = false;
+};
+
+const CpuFeatures & GetCpuFeatures () noexcept;
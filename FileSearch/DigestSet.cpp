@@ -0,0 +1,308 @@
+
+#include "pch.h"
+#include "digestset.h"
+#include "filereader.h"
+
+// binary layout: "FSDS", digest size (4, little-endian), sorted digests
+static const unsigned char magic [4] = { 'F', 'S', 'D', 'S' };
+
+static const unsigned int max_prefix_bits = 24;
+
+template <size_t N>
+static void SortUnique (std::vector <unsigned char> & table)
+{
+	using Entry = std::array <unsigned char, N>;
+	static_assert (sizeof (Entry) == N, "digest entries must be packed");
+
+	Entry * begin = reinterpret_cast <Entry *> (table.data ());
+	Entry * end = begin + table.size () / N;
+	if (!std::is_sorted (begin, end))
+		std::sort (begin, end);
+	end = std::unique (begin, end);
+	table.resize (static_cast <size_t> (end - begin) * N);
+}
+
+static void SortUnique (std::vector <unsigned char> & table, size_t size)
+{
+	switch (size)
+	{
+	case 16:
+		SortUnique <16> (table);
+		break;
+	case 20:
+		SortUnique <20> (table);
+		break;
+	case 32:
+		SortUnique <32> (table);
+		break;
+	default:
+	{
+		// any other size, sorted through a list of offsets
+		std::vector <size_t> offsets (table.size () / size);
+		for (size_t i = 0; i < offsets.size (); i++)
+			offsets [i] = i * size;
+		auto less = [&](size_t a, size_t b) { return std::memcmp (table.data () + a, table.data () + b, size) < 0; };
+		auto equal = [&](size_t a, size_t b) { return std::memcmp (table.data () + a, table.data () + b, size) == 0; };
+		std::sort (offsets.begin (), offsets.end (), less);
+		offsets.erase (std::unique (offsets.begin (), offsets.end (), equal), offsets.end ());
+
+		std::vector <unsigned char> sorted (offsets.size () * size);
+		for (size_t i = 0; i < offsets.size (); i++)
+			std::memcpy (sorted.data () + i * size, table.data () + offsets [i], size);
+		table.swap (sorted);
+	}
+	}
+}
+
+static inline int HexValue (unsigned char c) noexcept
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+void DigestSet::SetDigestSize (size_t size) noexcept
+{
+	m_digest_size = std::min (size, Digest::m_lMaxSize);
+}
+
+void DigestSet::Add (const Digest & digest)
+{
+	if (digest.size != m_digest_size)
+		return;
+
+	m_table.insert (m_table.end (), digest.data (), digest.data () + digest.size);
+}
+
+bool DigestSet::LoadFile (const std::wstring & path, std::wstring & error)
+{
+	FileReader reader;
+	if (!reader.Open (path.c_str ()))
+	{
+		error = L"Cannot open " + path;
+		return false;
+	}
+
+	size_t before = m_table.size ();
+	std::vector <unsigned char> line;		// cut by the end of a window
+	bool first = true;
+
+	const unsigned char * data = nullptr;
+	size_t size = 0;
+	while (reader.Next (data, size) && size > 0)
+	{
+		if (first && size >= sizeof (magic) && std::memcmp (data, magic, sizeof (magic)) == 0)
+		{
+			reader.Close ();
+			if (!MapBinary (path))
+			{
+				error = L"No sorted " + std::to_wstring (m_digest_size * 8) + L"-bit digests in " + path;
+				return false;
+			}
+			return true;
+		}
+		first = false;
+
+		const unsigned char * end = data + size;
+		const unsigned char * last = end;
+		while (last > data && last [-1] != '\n')
+			last--;
+		if (last == data)
+		{
+			line.insert (line.end (), data, end);
+			continue;
+		}
+
+		// the rest of the line the previous window ended in, the whole
+		// lines of this one, and the start of its last line is kept
+		const unsigned char * start = data;
+		if (!line.empty ())
+		{
+			start = static_cast <const unsigned char *> (std::memchr (data, '\n', size)) + 1;
+			line.insert (line.end (), data, start);
+			ParseText (line.data (), line.size ());
+			line.clear ();
+		}
+		ParseText (start, static_cast <size_t> (last - start));
+		line.assign (last, end);
+	}
+
+	if (reader.Error () != 0)
+	{
+		error = L"Cannot read " + path;
+		return false;
+	}
+	ParseText (line.data (), line.size ());
+
+	if (m_table.size () == before)
+	{
+		error = L"No " + std::to_wstring (m_digest_size * 8) + L"-bit digests in " + path;
+		return false;
+	}
+	return true;
+}
+
+// A binary list is used in place if it is sorted without duplicates and
+// the set holds nothing else yet. Otherwise its digests are copied
+bool DigestSet::MapBinary (const std::wstring & path)
+{
+	std::unique_ptr <void, decltype (&CloseHandle)> file (
+		::CreateFile (path.c_str (), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr), CloseHandle);
+	if (INVALID_HANDLE_VALUE == file.get ())
+	{
+		file.release ();
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!::GetFileSizeEx (file.get (), &size) || static_cast <uint64_t> (size.QuadPart) < sizeof (magic) + 4 ||
+		static_cast <uint64_t> (size.QuadPart) > (size_t)-1)
+		return false;
+
+	std::unique_ptr <void, decltype (&CloseHandle)> mapping (::CreateFileMapping (file.get (), nullptr, PAGE_READONLY, 0, 0, nullptr), CloseHandle);
+	if (nullptr == mapping)
+		return false;
+
+	// the view keeps the mapping alive
+	std::unique_ptr <void, decltype (&UnmapViewOfFile)> view (::MapViewOfFile (mapping.get (), FILE_MAP_READ, 0, 0, 0), UnmapViewOfFile);
+	if (nullptr == view)
+		return false;
+
+	const unsigned char * ptr = static_cast <const unsigned char *> (view.get ()) + sizeof (magic);
+	size_t digest_size = ptr [0] | ptr [1] << 8 | ptr [2] << 16 | static_cast <size_t> (ptr [3]) << 24;
+	ptr += 4;
+
+	size_t length = static_cast <size_t> (size.QuadPart) - sizeof (magic) - 4;
+	if (digest_size != m_digest_size || length % digest_size != 0 || 0 == length)
+		return false;
+
+	size_t count = length / digest_size;
+	bool sorted = true;
+	for (size_t i = 1; i < count && sorted; i++)
+		sorted = std::memcmp (ptr + (i - 1) * digest_size, ptr + i * digest_size, digest_size) < 0;
+
+	if (sorted && m_table.empty () && nullptr == m_view)
+	{
+		m_view = std::move (view);
+		m_mapped = ptr;
+		m_mapped_count = count;
+	}
+	else
+		m_table.insert (m_table.end (), ptr, ptr + length);
+	return true;
+}
+
+void DigestSet::ParseText (const unsigned char * text, size_t size)
+{
+	// the first run of hex digits of the digest length on each line, which
+	// skips file names, sizes and the quotes of the NSRL CSV files
+	const size_t width = m_digest_size * 2;
+
+	const unsigned char * ptr = text;
+	const unsigned char * end = ptr + size;
+	while (ptr < end)
+	{
+		const unsigned char * eol = static_cast <const unsigned char *> (std::memchr (ptr, '\n', end - ptr));
+		if (nullptr == eol)
+			eol = end;
+
+		for (const unsigned char * p = ptr; p < eol; )
+		{
+			if (HexValue (*p) < 0)
+			{
+				p++;
+				continue;
+			}
+
+			const unsigned char * run = p;
+			while (p < eol && HexValue (*p) >= 0)
+				p++;
+
+			if (static_cast <size_t> (p - run) == width)
+			{
+				for (size_t i = 0; i < m_digest_size; i++)
+					m_table.push_back (static_cast <unsigned char> (HexValue (run [i * 2]) << 4 | HexValue (run [i * 2 + 1])));
+				break;
+			}
+		}
+
+		ptr = eol + 1;
+	}
+}
+
+void DigestSet::Build ()
+{
+	m_index.clear ();
+	m_digests = nullptr;
+	m_count = 0;
+	if (0 == m_digest_size)
+		return;
+
+	// digests added next to a mapped list all go in the table
+	if (nullptr != m_view && !m_table.empty ())
+	{
+		m_table.insert (m_table.end (), m_mapped, m_mapped + m_mapped_count * m_digest_size);
+		m_view.reset ();
+		m_mapped = nullptr;
+		m_mapped_count = 0;
+	}
+
+	if (nullptr != m_view)
+	{
+		m_digests = m_mapped;
+		m_count = m_mapped_count;
+	}
+	else
+	{
+		if (m_table.empty ())
+			return;
+		SortUnique (m_table, m_digest_size);
+		m_digests = m_table.data ();
+		m_count = m_table.size () / m_digest_size;
+	}
+
+	// two to four digests per slot, at most 2^24 slots of the first 3 bytes
+	m_prefix_bits = 1;
+	while (m_prefix_bits < max_prefix_bits && (size_t (4) << m_prefix_bits) <= m_count)
+		m_prefix_bits++;
+	if (m_digest_size < 3)
+		m_prefix_bits = std::min <unsigned int> (m_prefix_bits, static_cast <unsigned int> (m_digest_size * 8));
+
+	m_index.assign ((size_t (1) << m_prefix_bits) + 1, 0);
+	for (size_t i = 0; i < m_count; i++)
+		m_index [Prefix (m_digests + i * m_digest_size) + 1]++;
+	for (size_t i = 1; i < m_index.size (); i++)
+		m_index [i] += m_index [i - 1];
+}
+
+uint32_t DigestSet::Prefix (const unsigned char * digest) const noexcept
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < 3; i++)
+		value = value << 8 | (i < m_digest_size ? digest [i] : 0);
+	return value >> (24 - m_prefix_bits);
+}
+
+bool DigestSet::Contains (const Digest & digest) const noexcept
+{
+	if (digest.size != m_digest_size || m_index.empty ())
+		return false;
+
+	uint32_t prefix = Prefix (digest.data ());
+	const unsigned char * ptr = m_digests + static_cast <size_t> (m_index [prefix]) * m_digest_size;
+	const unsigned char * end = m_digests + static_cast <size_t> (m_index [prefix + 1]) * m_digest_size;
+
+	for (; ptr < end; ptr += m_digest_size)
+	{
+		int cmp = std::memcmp (ptr, digest.data (), m_digest_size);
+		if (0 == cmp)
+			return true;
+		if (cmp > 0)
+			break;
+	}
+	return false;
+}
@@ -0,0 +1,54 @@
+
+#pragma once
+#include "hasher.h"
+
+// Digests to look files up by, all of one size. They are kept in a flat
+// sorted table with an index by the leading bits, so a lookup reads one
+// index slot and compares against a couple of table entries, however many
+// digests there are. Lists are read from text files with a hex digest per
+// line, as hash tools and the NSRL CSV files write them, a window at a
+// time, or from a binary file of sorted digests, mapped and used in place
+class DigestSet
+{
+	std::vector <unsigned char> m_table;	// digests added or read from text, back to back
+	std::unique_ptr <void, decltype (&UnmapViewOfFile)> m_view { nullptr, UnmapViewOfFile };
+	const unsigned char * m_mapped = nullptr;	// digests of a binary list in m_view
+	size_t m_mapped_count = 0;
+
+	const unsigned char * m_digests = nullptr;	// sorted, in m_table or m_view
+	size_t m_digest_size = 0;
+	size_t m_count = 0;
+
+	std::vector <uint32_t> m_index;			// first entry of each prefix
+	unsigned int m_prefix_bits = 0;
+
+public:
+	// size of the digests kept, set before anything is added
+	void SetDigestSize (size_t size) noexcept;
+	size_t DigestSize () const noexcept { return m_digest_size; }
+
+	void Add (const Digest & digest);
+	bool LoadFile (const std::wstring & path, std::wstring & error);
+
+	// sorts the digests, drops duplicates and builds the index. Required
+	// after adding digests and before lookups
+	void Build ();
+
+	bool Contains (const Digest & digest) const noexcept;
+
+	inline bool empty () const noexcept
+	{
+		return 0 == m_count;
+	}
+
+	inline size_t size () const noexcept
+	{
+		return m_count;
+	}
+
+private:
+	// whole lines of text
+	void ParseText (const unsigned char * text, size_t size);
+	bool MapBinary (const std::wstring & path);
+	uint32_t Prefix (const unsigned char * digest) const noexcept;
+};
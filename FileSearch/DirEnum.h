@@ -1,5 +1,7 @@
 
 #pragma once
+#include "MaskSet.h"
+#include "VerdictCache.h"
 
 using ListOfStrings = std::list <std::wstring>;
 using ListOfPaths = std::list <std::filesystem::path>;
@@ -8,29 +10,19 @@ struct IDirEnumHandler
 {
 	virtual void OnGivenPathFail (const std::wstring & file, std::wstring error) = 0;
 
-	virtual void OnFileFound (std::filesystem::path && file, uintmax_t size) = 0;
 	virtual void OnFileFound (const std::filesystem::path & file, uintmax_t size) = 0;
 
 	virtual void OnDirFound (const std::filesystem::path & dir) = 0;
 
 	virtual void OnScanError (const std::string & error) = 0;
-};
-
 
-struct EnumException
-{
-	std::string error;
+	// whether OnFileFound may run on several enumeration threads at once,
+	// instead of one call at a time under a lock
+	virtual bool IsFileFoundConcurrent () const { return false; }
 };
 
 class DirEnumerator
 {
-	struct Mask
-	{
-		std::wstring mask;
-		bool use_regex = true;
-	};
-	using ListOfMasks = std::list <Mask>;
-
 	IDirEnumHandler * m_pHandler = nullptr;
 
 	ListOfPaths m_dir_pathes;
@@ -38,33 +30,76 @@ class DirEnumerator
 
 	uintmax_t m_min_size = 0;
 	uintmax_t m_max_size = (uintmax_t)-1;
+	bool m_need_size = true;
 
-	ListOfMasks m_exc_file_mask;
-	ListOfMasks m_exc_dir_mask;
+	MaskSet m_exc_file_mask;
+	MaskSet m_exc_dir_mask;
 
-	ListOfMasks m_inc_file_mask;
-	ListOfMasks m_inc_dir_mask;
+	MaskSet m_inc_file_mask;
+	MaskSet m_inc_dir_mask;
 
-	ListOfMasks m_inc_path_mask;
-	ListOfMasks m_exc_path_mask;
+	MaskSet m_inc_path_mask;
+	MaskSet m_exc_path_mask;
 
 	bool m_opt_file = false;
 	bool m_opt_dir = false;
 	bool m_opt_path = false;
 
+	size_t m_threads = 1;
+	std::mutex m_handler_mutex;
+
+	VerdictCache m_verdicts;
+
+#ifndef _WIN32
+	// fd of a scanned directory kept open for openat of its subdirectories,
+	// closed with the last of them
+	using DirFd = std::shared_ptr <int>;
+	static const size_t m_lMaxDirFds = 256;			// kept open at once, the rest are opened by full path
+	size_t m_max_dir_fds = m_lMaxDirFds;			// lower if the fd limit of the process is
+	std::atomic <size_t> m_dir_fds { 0 };
+#endif
+
 	enum class ObjType
 	{
 		file, directory, path
 	};
 
+	// queued directory. Whether it passes the include masks is decided once,
+	// when the directory itself is found, and its files only run file checks
+	struct DirEntry
+	{
+		std::filesystem::path path;
+		bool included = true;
+#ifndef _WIN32
+		DirFd parent;								// open fd of the parent directory, if kept
+#endif
+	};
+	using ListOfDirs = std::list <DirEntry>;
+
 private:
-	bool MatchMask (const Mask & mask, const std::wstring & str);
+	void AddFileList (ListOfStrings & list, MaskSet & add_to);
+	bool IsObjectIgnored (std::wstring_view obj, uintmax_t filesize, ObjType type, bool scan_dir_includes);
+	bool IsDirectoryIncluded (std::wstring_view path, std::wstring_view name);
+	using ScanFunc = void (DirEnumerator::*) (const DirEntry & dir, ListOfDirs & subdirs);
+	ScanFunc SelectScanFunc () const;
 
-	void AddFileList (ListOfStrings & list, ListOfMasks & add_to);
-	bool IsObjectIgnored (std::wstring & obj, uintmax_t filesize, ObjType type, bool scan_dir_includes);
+	DirEntry MakeRootEntry (const std::filesystem::path & root);
 	void EnumerateDirectory (const std::filesystem::path & root);
-	void EnumerateDirectory_Win7 (const std::filesystem::path & root);
-	void EnumerateDirectory_WinXp (const std::filesystem::path & root);
+	void EnumerateParallel (const ListOfPaths & roots);
+	// path and name are views of the entry found in dir, the entry path itself
+	// is only built once the entry passes the masks
+	void OnEntryFound (const DirEntry & dir, std::wstring_view path, std::wstring_view name, const std::filesystem::path::value_type * native_name,
+		bool is_dir, uintmax_t size, ListOfDirs & subdirs);
+#ifdef _WIN32
+	void ScanDirectory_Win7 (const DirEntry & dir, ListOfDirs & subdirs);
+	void ScanDirectory_WinXp (const DirEntry & dir, ListOfDirs & subdirs);
+#else
+	void ScanDirectory_Posix (const DirEntry & dir, ListOfDirs & subdirs);
+#endif
+
+	void NotifyFileFound (std::filesystem::path && file, uintmax_t size);
+	void NotifyDirFound (const std::filesystem::path & dir);
+	void NotifyScanError (const std::string & error);
 
 public:
 	DirEnumerator (IDirEnumHandler * handler);
@@ -78,5 +113,18 @@ public:
 	void AddIncludePaths (ListOfStrings & list);
 	void SetFileLimit (uintmax_t minsize = 0, uintmax_t maxsize = (uintmax_t)-1);
 
+	// whether OnFileFound needs a real file size. A size limit set by
+	// SetFileLimit requires it anyway. Backends that have to stat a file
+	// to learn its size skip that call otherwise and report 0
+	void SetSizeRequired (bool required);
+
+	// number of traversal threads, 0 means one per CPU core. IDirEnumHandler
+	// callbacks are serialized, so handlers need no locking of their own
+	void SetThreads (size_t threads);
+
+	// whether mask verdicts for file and directory names are memoized, on by
+	// default. The cache has a fixed size, full paths are never cached
+	void SetVerdictCache (bool enable);
+
 	void EnumerateDirectory ();
 };
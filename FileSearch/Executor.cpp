@@ -0,0 +1,93 @@
+
+#include "pch.h"
+#include "executor.h"
+
+Executor::Executor (size_t cpu_threads, size_t io_threads)
+{
+	Start (m_cpu, cpu_threads);
+	Start (m_io, io_threads);
+}
+
+Executor::~Executor ()
+{
+	{
+		std::lock_guard <std::mutex> lk (m_lock);
+		m_stop = true;
+	}
+	m_cpu.ready.notify_all ();
+	m_io.ready.notify_all ();
+
+	for (auto queue : { &m_cpu, &m_io })
+	{
+		for (auto & t : queue->threads)
+			t.join ();
+	}
+}
+
+void Executor::Start (Queue & queue, size_t threads)
+{
+	if (0 == threads)
+		threads = std::thread::hardware_concurrency ();
+	if (0 == threads)
+		threads = 1;
+
+	for (size_t i = 0; i < threads; i++)
+		queue.threads.emplace_back (&Executor::Loop, this, std::ref (queue));
+}
+
+void Executor::Submit (Pool pool, Task && task)
+{
+	Queue & queue = (Pool::io == pool ? m_io : m_cpu);
+	{
+		std::lock_guard <std::mutex> lk (m_lock);
+		queue.tasks.push_back (std::move (task));
+		m_pending++;
+	}
+	queue.ready.notify_one ();
+}
+
+void Executor::Wait ()
+{
+	std::unique_lock <std::mutex> lk (m_lock);
+	m_idle.wait (lk, [this] { return 0 == m_pending; });
+
+	if (m_error != nullptr)
+	{
+		auto error = m_error;
+		m_error = nullptr;
+		std::rethrow_exception (error);
+	}
+}
+
+void Executor::Loop (Queue & queue)
+{
+	for (;;)
+	{
+		Task task;
+		{
+			std::unique_lock <std::mutex> lk (m_lock);
+			queue.ready.wait (lk, [&] { return m_stop || !queue.tasks.empty (); });
+			if (queue.tasks.empty ())
+				return;
+
+			task = std::move (queue.tasks.front ());
+			queue.tasks.pop_front ();
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			task ();
+		}
+		catch (...)
+		{
+			error = std::current_exception ();
+		}
+
+		std::lock_guard <std::mutex> lk (m_lock);
+		if (error != nullptr && nullptr == m_error)
+			m_error = error;
+		if (0 == --m_pending)
+			m_idle.notify_all ();
+	}
+}
@@ -0,0 +1,58 @@
+
+#pragma once
+
+// Task executor with two pools of threads: one for tasks that mostly read
+// files and one for tasks that mostly compute. The size of the I/O pool is
+// the cap on reads in flight, so a big batch of reads never turns into
+// more concurrent requests than the disk can serve well (one is best for a
+// spinning disk). Tasks may submit more tasks to either pool and report
+// their results through callbacks they capture
+class Executor
+{
+public:
+	using Task = std::function <void ()>;
+
+	enum class Pool
+	{
+		cpu, io
+	};
+
+private:
+	struct Queue
+	{
+		std::deque <Task> tasks;
+		std::vector <std::thread> threads;
+		std::condition_variable ready;
+	};
+
+	std::mutex m_lock;
+	Queue m_cpu;
+	Queue m_io;
+	size_t m_pending = 0;				// submitted and not finished yet
+	bool m_stop = false;
+	std::condition_variable m_idle;
+	std::exception_ptr m_error;
+
+public:
+	// 0 means one thread per CPU core
+	Executor (size_t cpu_threads, size_t io_threads);
+	~Executor ();
+
+	Executor (const Executor &) = delete;
+	Executor & operator = (const Executor &) = delete;
+
+	void Submit (Pool pool, Task && task);
+
+	inline size_t Threads (Pool pool) const noexcept
+	{
+		return (Pool::io == pool ? m_io : m_cpu).threads.size ();
+	}
+
+	// returns once every task, including the ones submitted by other tasks,
+	// has finished. Rethrows the first exception a task has thrown
+	void Wait ();
+
+private:
+	void Start (Queue & queue, size_t threads);
+	void Loop (Queue & queue);
+};
@@ -1,28 +1,41 @@
 #pragma once
+#include "hasher.h"
+#include "hashcache.h"
+#include "filereader.h"
+#include "digestset.h"
+#include "contentsearch.h"
+#include "pathtable.h"
 
 using FileHandle = std::unique_ptr <void, decltype (&CloseHandle)>;
-using ViewHandle = std::unique_ptr <unsigned char, decltype (&UnmapViewOfFile)>;
+
+class Executor;
 
 class File
 {
-	std::filesystem::path m_filepath;
+	PathTable::Ref m_path;
 	uintmax_t m_size = 0;
 
-	std::wstring m_hash;
+	Digest m_digest;
+	HashAlgo m_hashed_with = HashAlgo::sha1;
 	DWORD m_error = NO_ERROR;
 	bool m_filtering_result = true;
 
-	ViewHandle m_pmap;
-	FileHandle m_hmap;
-	FileHandle m_hfile;
+	std::vector <ContentMatch> m_matches;	// if the content search wants them all
 
-	std::vector <unsigned char> m_buffer;
+	BufferPool::Buffer m_buffer;			// a small file read whole, see OpenFile
+	size_t m_buffer_size = 0;
 
 public:
-	static uintmax_t m_lMaxHeapSize;
-
-	File (std::filesystem::path && path);
-	File (std::filesystem::path && path, uintmax_t size);
+	static uintmax_t m_lMaxBatchSize;		// bigger files are hashed alone by CalcHashes
+	static HashAlgo m_hash_algo;			// algorithm CalcHash uses
+	static uintmax_t m_lTreeChunkSize;		// 0 or the chunk size of tree hashes, see TreeHash
+	static constexpr uintmax_t m_lMinTreeChunkSize = 64 * 1024;	// smaller chunks cost more than they save
+	static HashCache * m_hash_cache;		// hashes of unchanged files are taken from it
+	static PathTable m_paths;				// paths of all files, interned
+	static Executor * m_executor;			// cpu pool tree hash chunks are spread over, if any, its io pool size caps them
+
+	File (const std::filesystem::path & path);
+	File (const std::filesystem::path & path, uintmax_t size);
 	~File ();
 
 	File (const File &) = delete;
@@ -31,14 +44,14 @@ public:
 	File (File &&) noexcept = default;
 	File & operator = (File &&) noexcept = default;
 
-	inline const wchar_t * Path () const noexcept
-	{
-		return m_filepath.c_str ();
-	}
+	// built from m_paths on every call, an operation on the file builds it
+	// once and passes it on
+	std::wstring Path () const;
+	std::wstring Ext () const;
 
-	inline std::wstring Ext () const noexcept
+	inline const PathTable::Ref & PathRef () const noexcept
 	{
-		return m_filepath.extension ().wstring ();
+		return m_path;
 	}
 
 	inline uintmax_t Size () const noexcept
@@ -48,9 +61,22 @@ public:
 
 	std::wstring SizeFormatted () const noexcept;
 
-	inline const std::wstring & Hash () const noexcept
+	inline const Digest & HashDigest () const noexcept
+	{
+		return m_digest;
+	}
+
+	// hex of the digest, to print
+	inline std::wstring Hash () const
 	{
-		return m_hash;
+		return m_digest.ToHex ();
+	}
+
+	// hashes of different algorithms never compare equal, even if the
+	// strings happen to
+	inline HashAlgo HashAlgorithm () const noexcept
+	{
+		return m_hashed_with;
 	}
 
 	inline const bool Failed () const noexcept
@@ -68,14 +94,49 @@ public:
 		return m_filtering_result;
 	}
 
-	bool CalcHash () noexcept;
-	bool CompareTo (File & obj) noexcept;
-	bool MatchFilter (const std::list <std::wstring> & hashes, const std::basic_string <unsigned char> & content) noexcept;
+	// content matches in the order of their offsets
+	inline const std::vector <ContentMatch> & Matches () const noexcept
+	{
+		return m_matches;
+	}
+
+	// With content given, the content filter runs on the same read of the
+	// file as the hash and sets FilteringResult. A file failing it keeps
+	// its hash, computed by then anyway. Tree hashes read the file apart
+	bool CalcHash (const ContentSearch * content = nullptr) noexcept;
+	// CalcHash for every file. With SHA-1 the small ones are hashed together
+	// in the SIMD lanes of a Sha1Batch. Up to Sha1Batch::PreferredCount files
+	// are read into memory at once, pass more and they go in several batches.
+	// Small files are searched for content in memory and hashed only if
+	// they pass
+	static void CalcHashes (const std::vector <File *> & files, const ContentSearch * content = nullptr) noexcept;
+	// reads the file front to back in windows of reader, errors are the file's
+	bool OpenStream (FileReader & reader, size_t window) noexcept;
+	bool ReadStream (FileReader & reader, const unsigned char * & data, size_t & size) noexcept;
+	// reads up to size bytes at offset, fewer at the end of the file
+	bool ReadRange (uintmax_t offset, size_t size, std::vector <unsigned char> & buffer) noexcept;
+	bool MatchFilter (const DigestSet & hashes, const ContentSearch & content) noexcept;
 
 private:
-	bool OpenFile () noexcept;
+	// Path, out of memory is the file's error
+	bool BuildPath (std::wstring & path) noexcept;
+	bool CalcHash (const std::wstring & path, const ContentSearch * content) noexcept;
+	bool OpenFile (const std::wstring & path) noexcept;
 	void CloseFile () noexcept;
-	const unsigned char * FilePtr () const noexcept;
+	bool UseTreeHash () const noexcept;
+	// the content filter alone, on a read of its own
+	bool MatchContent (const std::wstring & path, const ContentSearch & content) noexcept;
+	// the content filter on a file read whole by OpenFile
+	bool MatchBuffer (const ContentSearch & content) noexcept;
+	bool FindCachedHash (const HashCache::Key & key, HashAlgo algo) noexcept;
+	void CacheHash (const HashCache::Key & key, const Digest & digest) noexcept;
+	Digest TreeHash (const std::wstring & path, HashAlgo algo);
+	// Passes the file window after window to every consumer, until each
+	// returns false, in one read. Exceptions of consumers fail the read
+	using Consumer = std::function <bool (const unsigned char *, size_t)>;
+	bool ReadWindows (const std::wstring & path, const std::vector <Consumer> & consumers) noexcept;
+	bool ReadWindows (const std::wstring & path, const Consumer & consume) noexcept;
+	void SetHash (const Digest & digest, HashAlgo algo) noexcept;
 };
 
 using ListOfFiles = std::list <File>;
\ No newline at end of file
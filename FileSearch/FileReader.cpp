@@ -0,0 +1,276 @@
+
+#include "pch.h"
+#include "filereader.h"
+
+size_t FileReader::m_lWindowSize = 1024 * 1024;
+
+FileReader::~FileReader ()
+{
+	Close ();
+}
+
+#ifdef _WIN32
+
+bool FileReader::Open (const wchar_t * path, size_t window, uintmax_t offset, uintmax_t length) noexcept
+{
+	Close ();
+	m_error = NO_ERROR;
+
+	HANDLE h = ::CreateFile (path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (INVALID_HANDLE_VALUE == h)
+	{
+		m_error = ::GetLastError ();
+		return false;
+	}
+	m_hfile.reset (h);
+
+	// a small file gets a small window
+	LARGE_INTEGER size = {};
+	if (!::GetFileSizeEx (m_hfile.get (), &size))
+	{
+		m_error = ::GetLastError ();
+		Close ();
+		return false;
+	}
+	uintmax_t file_size = static_cast <uintmax_t> (size.QuadPart);
+	m_offset = std::min (offset, file_size);
+	m_end = m_offset + std::min (length, file_size - m_offset);
+	m_window_size = static_cast <size_t> (std::min <uintmax_t> (std::max <size_t> (window, 1), std::max <uintmax_t> (m_end - m_offset, 1)));
+
+	try
+	{
+		for (auto & w : m_windows)
+		{
+			w.buffer = BufferPool::Get (m_window_size);
+			w.event.reset (::CreateEvent (nullptr, TRUE, FALSE, nullptr));
+			if (nullptr == w.event)
+			{
+				m_error = ::GetLastError ();
+				Close ();
+				return false;
+			}
+		}
+	}
+	catch (...)
+	{
+		m_error = ERROR_NOT_ENOUGH_MEMORY;
+		Close ();
+		return false;
+	}
+
+	m_current = 0;
+	m_returned = false;
+	if (!Request (m_windows [0]) || !Request (m_windows [1]))
+	{
+		Close ();
+		return false;
+	}
+	return true;
+}
+
+bool FileReader::Request (Window & window) noexcept
+{
+	window.size = static_cast <size_t> (std::min <uintmax_t> (m_window_size, m_end - m_offset));
+	window.pending = false;
+	if (0 == window.size)
+		return true;
+
+	window.ov = {};
+	window.ov.Offset = static_cast <DWORD> (m_offset);
+	window.ov.OffsetHigh = static_cast <DWORD> (m_offset >> 32);
+	window.ov.hEvent = window.event.get ();
+	m_offset += window.size;
+
+	if (!::ReadFile (m_hfile.get (), window.buffer.data (), static_cast <DWORD> (window.size), nullptr, &window.ov))
+	{
+		DWORD error = ::GetLastError ();
+		if (ERROR_HANDLE_EOF == error)
+		{
+			window.size = 0;
+			return true;
+		}
+		if (error != ERROR_IO_PENDING)
+		{
+			m_error = error;
+			return false;
+		}
+	}
+	window.pending = true;
+	return true;
+}
+
+bool FileReader::Next (const unsigned char * & data, size_t & size) noexcept
+{
+	size = 0;
+	if (nullptr == m_hfile)
+	{
+		m_error = ERROR_INVALID_HANDLE;
+		return false;
+	}
+
+	// the window given away last time is free to read ahead into
+	if (m_returned)
+	{
+		if (!Request (m_windows [m_current]))
+			return false;
+		m_current ^= 1;
+	}
+
+	Window & window = m_windows [m_current];
+	m_returned = true;
+	data = window.buffer.data ();
+	if (!window.pending)
+		return true;
+
+	DWORD read = 0;
+	window.pending = false;
+	if (!::GetOverlappedResult (m_hfile.get (), &window.ov, &read, TRUE))
+	{
+		DWORD error = ::GetLastError ();
+		if (error != ERROR_HANDLE_EOF)
+		{
+			m_error = error;
+			return false;
+		}
+	}
+
+	size = read;
+	return true;
+}
+
+void FileReader::Close () noexcept
+{
+	if (nullptr == m_hfile)
+		return;
+
+	// the buffers of reads in flight must outlive them
+	for (auto & w : m_windows)
+	{
+		if (w.pending)
+		{
+			DWORD read = 0;
+			::CancelIoEx (m_hfile.get (), &w.ov);
+			::GetOverlappedResult (m_hfile.get (), &w.ov, &read, TRUE);
+			w.pending = false;
+		}
+		w.buffer.Release ();
+	}
+	m_hfile.reset ();
+}
+
+#else
+
+bool FileReader::Open (const wchar_t * path, size_t window, uintmax_t offset, uintmax_t length) noexcept
+{
+	Close ();
+	m_error = 0;
+
+	try
+	{
+		m_fd = ::open (std::filesystem::path (path).c_str (), O_RDONLY | O_CLOEXEC);
+	}
+	catch (...)
+	{
+		m_error = ENOMEM;
+		return false;
+	}
+	if (m_fd < 0)
+	{
+		m_error = errno;
+		return false;
+	}
+
+	struct stat st = {};
+	if (::fstat (m_fd, &st) != 0)
+	{
+		m_error = errno;
+		Close ();
+		return false;
+	}
+	uintmax_t file_size = static_cast <uintmax_t> (st.st_size);
+	m_offset = std::min (offset, file_size);
+	m_end = m_offset + std::min (length, file_size - m_offset);
+	m_window_size = static_cast <size_t> (std::min <uintmax_t> (std::max <size_t> (window, 1), std::max <uintmax_t> (m_end - m_offset, 1)));
+	m_returned = m_offset;
+
+	try
+	{
+		m_window.buffer = BufferPool::Get (m_window_size);
+	}
+	catch (...)
+	{
+		m_error = ENOMEM;
+		Close ();
+		return false;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	::posix_fadvise (m_fd, static_cast <off_t> (m_offset), static_cast <off_t> (m_end - m_offset), POSIX_FADV_SEQUENTIAL);
+#endif
+	return true;
+}
+
+bool FileReader::Request (Window & window) noexcept
+{
+	window.size = static_cast <size_t> (std::min <uintmax_t> (m_window_size, m_end - m_offset));
+	size_t read = 0;
+	while (read < window.size)
+	{
+		ssize_t part = ::pread (m_fd, window.buffer.data () + read, window.size - read, static_cast <off_t> (m_offset + read));
+		if (part < 0 && EINTR == errno)
+			continue;
+		if (part < 0)
+		{
+			m_error = errno;
+			return false;
+		}
+		if (0 == part)
+			break;
+		read += static_cast <size_t> (part);
+	}
+
+	m_returned = m_offset;
+	m_offset += window.size;
+	window.size = read;
+
+#ifdef POSIX_FADV_WILLNEED
+	if (m_offset < m_end)
+		::posix_fadvise (m_fd, static_cast <off_t> (m_offset), static_cast <off_t> (std::min <uintmax_t> (m_window_size, m_end - m_offset)), POSIX_FADV_WILLNEED);
+#endif
+	return true;
+}
+
+bool FileReader::Next (const unsigned char * & data, size_t & size) noexcept
+{
+	size = 0;
+	if (m_fd < 0)
+	{
+		m_error = EBADF;
+		return false;
+	}
+
+#ifdef POSIX_FADV_DONTNEED
+	// the caller is done with the window given away last time
+	if (m_offset > m_returned)
+		::posix_fadvise (m_fd, static_cast <off_t> (m_returned), static_cast <off_t> (m_offset - m_returned), POSIX_FADV_DONTNEED);
+#endif
+
+	if (!Request (m_window))
+		return false;
+
+	data = m_window.buffer.data ();
+	size = m_window.size;
+	return true;
+}
+
+void FileReader::Close () noexcept
+{
+	if (m_fd < 0)
+		return;
+
+	::close (m_fd);
+	m_fd = -1;
+	m_window.buffer.Release ();
+}
+
+#endif
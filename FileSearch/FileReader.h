@@ -0,0 +1,63 @@
+
+#pragma once
+#include "bufferpool.h"
+
+// Reads a file, or a range of it, front to back in windows of a fixed size,
+// so memory does not depend on the file size. While the caller works on one
+// window the next one is being read: an overlapped read on Windows, a
+// posix_fadvise WILLNEED hint elsewhere, where the windows read are also
+// dropped from the page cache so that a scan does not evict everything else
+class FileReader
+{
+public:
+	static size_t m_lWindowSize;
+
+private:
+	struct Window
+	{
+		BufferPool::Buffer buffer;
+		size_t size = 0;						// requested
+#ifdef _WIN32
+		OVERLAPPED ov = {};
+		std::unique_ptr <void, decltype (&CloseHandle)> event { nullptr, CloseHandle };
+		bool pending = false;
+#endif
+	};
+
+#ifdef _WIN32
+	std::unique_ptr <void, decltype (&CloseHandle)> m_hfile { nullptr, CloseHandle };
+	Window m_windows [2];
+	size_t m_current = 0;
+	bool m_returned = false;				// the current window is the caller's
+#else
+	int m_fd = -1;
+	Window m_window;
+	uintmax_t m_returned = 0;				// offset of the window the caller has
+#endif
+	size_t m_window_size = 0;
+	uintmax_t m_offset = 0;					// of the next window to request
+	uintmax_t m_end = 0;
+	unsigned long m_error = 0;
+
+public:
+	FileReader () = default;
+	~FileReader ();
+
+	FileReader (const FileReader &) = delete;
+	FileReader & operator = (const FileReader &) = delete;
+
+	bool Open (const wchar_t * path, size_t window = m_lWindowSize, uintmax_t offset = 0, uintmax_t length = (uintmax_t)-1) noexcept;
+	void Close () noexcept;
+
+	// the next window, valid until the next call. Size is 0 at the end
+	bool Next (const unsigned char * & data, size_t & size) noexcept;
+
+	// GetLastError or errno of the failure
+	inline unsigned long Error () const noexcept
+	{
+		return m_error;
+	}
+
+private:
+	bool Request (Window & window) noexcept;
+};
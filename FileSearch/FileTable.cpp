@@ -0,0 +1,43 @@
+
+#include "pch.h"
+#include "filetable.h"
+
+std::atomic <uint64_t> FileTable::m_last_id { 0 };
+thread_local FileTable::Cursor FileTable::m_cursor;
+
+FileTable::FileTable () :
+	m_id (++m_last_id)
+{
+}
+
+FileTable::~FileTable ()
+{
+	Chunk * chunk = m_chunks.load (std::memory_order_acquire);
+	while (chunk != nullptr)
+	{
+		for (size_t i = 0; i < chunk->used; i++)
+			chunk->Files () [i].~File ();
+
+		Chunk * next = chunk->next;
+		delete chunk;
+		chunk = next;
+	}
+}
+
+File * FileTable::Add (const std::filesystem::path & path, uintmax_t size)
+{
+	Cursor & cursor = m_cursor;
+	if (cursor.table != m_id || cursor.chunk->used == m_lChunkSize)
+	{
+		std::unique_ptr <Chunk> chunk (new Chunk);		// records are left uninitialized
+		chunk->next = m_chunks.load (std::memory_order_relaxed);
+		while (!m_chunks.compare_exchange_weak (chunk->next, chunk.get (), std::memory_order_release, std::memory_order_relaxed))
+			;
+		cursor = { m_id, chunk.release () };
+	}
+
+	File * file = new (cursor.chunk->Files () + cursor.chunk->used) File (path, size);
+	cursor.chunk->used++;
+	m_count.fetch_add (1, std::memory_order_relaxed);
+	return file;
+}
@@ -0,0 +1,72 @@
+
+#pragma once
+#include "file.h"
+
+// Files found by the enumeration, in chunks of m_lChunkSize records that
+// never move, so the File pointers handed out stay valid as long as the
+// table. Adding takes no lock: every thread fills a chunk of its own and
+// only links a new chunk into the table, with a compare-and-swap, when
+// its chunk is full
+class FileTable
+{
+public:
+	static const size_t m_lChunkSize = 1024;
+
+private:
+	struct Chunk
+	{
+		Chunk * next = nullptr;
+		size_t used = 0;
+		alignas (File) unsigned char records [m_lChunkSize * sizeof (File)];
+
+		inline File * Files () noexcept
+		{
+			return reinterpret_cast <File *> (records);
+		}
+	};
+
+	// the chunk a thread adds to, for the table it was taken for
+	struct Cursor
+	{
+		uint64_t table = 0;
+		Chunk * chunk = nullptr;
+	};
+
+	static std::atomic <uint64_t> m_last_id;
+	static thread_local Cursor m_cursor;
+
+	const uint64_t m_id;
+	std::atomic <Chunk *> m_chunks { nullptr };		// last linked first
+	std::atomic <size_t> m_count { 0 };
+
+public:
+	FileTable ();
+	~FileTable ();
+
+	FileTable (const FileTable &) = delete;
+	FileTable & operator = (const FileTable &) = delete;
+
+	// any number of threads at once
+	File * Add (const std::filesystem::path & path, uintmax_t size);
+
+	inline size_t size () const noexcept
+	{
+		return m_count.load (std::memory_order_relaxed);
+	}
+
+	// Every file, a chunk after chunk in the order they were linked. Not
+	// while files are still being added
+	template <class F>
+	void ForEach (F && f) const
+	{
+		std::vector <Chunk *> chunks;
+		for (Chunk * chunk = m_chunks.load (std::memory_order_acquire); chunk != nullptr; chunk = chunk->next)
+			chunks.push_back (chunk);
+
+		for (auto it = chunks.rbegin (); it != chunks.rend (); ++it)
+		{
+			for (size_t i = 0; i < (*it)->used; i++)
+				f ((*it)->Files () [i]);
+		}
+	}
+};
@@ -0,0 +1,121 @@
+
+#include "pch.h"
+#include "Glob.h"
+#include "CaseFold.h"
+
+GlobMask::GlobMask (std::wstring_view mask)
+{
+	for (auto c : mask)
+	{
+		if (L'*' == c && !m_mask.empty () && L'*' == m_mask.back ())
+			continue;
+		m_mask += FoldCase (c);
+	}
+
+	auto star = m_mask.find (L'*');
+	bool has_question = (m_mask.find (L'?') != std::wstring::npos);
+
+	if (std::wstring::npos == star)
+	{
+		m_head = m_mask;
+		m_min_length = m_mask.size ();
+		m_kind = has_question ? Kind::generic : Kind::literal;
+		return;
+	}
+
+	m_has_star = true;
+
+	auto last_star = m_mask.rfind (L'*');
+	m_head = m_mask.substr (0, star);
+	m_tail = m_mask.substr (last_star + 1);
+	m_min_length = m_head.size () + m_tail.size ();
+
+	for (size_t pos = star + 1; pos < last_star; )
+	{
+		auto next = m_mask.find (L'*', pos);
+		m_middle.push_back (m_mask.substr (pos, next - pos));
+		m_min_length += m_middle.back ().size ();
+		pos = next + 1;
+	}
+
+	if (1 == m_mask.size ())
+		m_kind = Kind::any;
+	else if (has_question || !m_middle.empty ())
+		m_kind = Kind::generic;
+	else if (m_tail.empty ())
+		m_kind = Kind::prefix;
+	else if (m_head.empty ())
+		m_kind = Kind::suffix;
+	else
+		m_kind = Kind::generic;
+}
+
+bool GlobMask::MatchSegment (const wchar_t * str, const std::wstring & segment) noexcept
+{
+	for (auto c : segment)
+	{
+		if (c != L'?' && c != FoldCase (*str))
+			return false;
+		str++;
+	}
+	return true;
+}
+
+size_t GlobMask::FindSegment (std::wstring_view str, size_t from, size_t to, const std::wstring & segment) noexcept
+{
+	wchar_t first = segment.front ();
+	for (size_t pos = from; pos + segment.size () <= to; pos++)
+	{
+		if (first != L'?' && first != FoldCase (str [pos]))
+			continue;
+		if (MatchSegment (str.data () + pos, segment))
+			return pos;
+	}
+	return std::wstring::npos;
+}
+
+bool GlobMask::Match (std::wstring_view str) const noexcept
+{
+	auto Equal = [](std::wstring_view str, const std::wstring & folded)
+	{
+		return str.size () == folded.size () && MatchSegment (str.data (), folded);
+	};
+
+	switch (m_kind)
+	{
+	case Kind::any:
+		return true;
+	case Kind::literal:
+		return Equal (str, m_mask);
+	case Kind::prefix:
+		return str.size () >= m_head.size () && Equal (str.substr (0, m_head.size ()), m_head);
+	case Kind::suffix:
+		return str.size () >= m_tail.size () && Equal (str.substr (str.size () - m_tail.size ()), m_tail);
+	default:
+		break;
+	}
+
+	if (!m_has_star)
+		return Equal (str, m_head);
+
+	if (str.size () < m_min_length)
+		return false;
+
+	if (!MatchSegment (str.data (), m_head))
+		return false;
+
+	size_t end = str.size () - m_tail.size ();
+	if (!MatchSegment (str.data () + end, m_tail))
+		return false;
+
+	size_t pos = m_head.size ();
+	for (auto & segment : m_middle)
+	{
+		pos = FindSegment (str, pos, end, segment);
+		if (std::wstring::npos == pos)
+			return false;
+		pos += segment.size ();
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+
+#pragma once
+
+// File mask with '*' (any run of symbols) and '?' (any single symbol),
+// compiled once and matched against the whole string. Plain names, pure
+// prefix ("abc*") and pure suffix ("*.txt") masks have dedicated fast paths.
+// Other masks are split by '*' into segments: the first one is matched at the
+// start, the last one at the end and the ones between are searched left to
+// right, leftmost occurrence first. That never needs to backtrack, so a match
+// costs at most one pass per segment over the string.
+// Matching ignores case: the mask is folded once and the string a symbol at
+// a time while it is compared
+class GlobMask
+{
+public:
+	enum class Kind
+	{
+		any, literal, prefix, suffix, generic
+	};
+
+	GlobMask (std::wstring_view mask);
+
+	bool Match (std::wstring_view str) const noexcept;
+
+	inline Kind Type () const noexcept
+	{
+		return m_kind;
+	}
+
+	// folded mask with runs of '*' collapsed
+	inline const std::wstring & Mask () const noexcept
+	{
+		return m_mask;
+	}
+
+private:
+	static bool MatchSegment (const wchar_t * str, const std::wstring & segment) noexcept;
+	static size_t FindSegment (std::wstring_view str, size_t from, size_t to, const std::wstring & segment) noexcept;
+
+private:
+	Kind m_kind = Kind::generic;
+	std::wstring m_mask;						// mask with runs of '*' collapsed
+
+	bool m_has_star = false;
+	std::wstring m_head;						// segment before the first '*'
+	std::wstring m_tail;						// segment after the last '*'
+	std::vector <std::wstring> m_middle;		// segments between them
+	size_t m_min_length = 0;					// symbols a match must have at least
+};
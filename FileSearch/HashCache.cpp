@@ -0,0 +1,331 @@
+
+#include "pch.h"
+#include "hashcache.h"
+
+// log layout, little-endian: "FSHC" and the version, then records of
+//   volume (4), file index (8), algorithm (1), tree chunk size (8),
+//   size (8), last write time (8), digest size (1), digest
+static const unsigned char magic [4] = { 'F', 'S', 'H', 'C' };
+static const size_t record_size = 4 + 8 + 1 + 8 + 8 + 8 + 1;
+
+template <class T>
+static void Put (std::vector <unsigned char> & buffer, T value)
+{
+	for (size_t i = 0; i < sizeof (T); i++)
+		buffer.push_back (static_cast <unsigned char> (static_cast <uint64_t> (value) >> (i * 8)));
+}
+
+template <class T>
+static T Get (const unsigned char * & ptr)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < sizeof (T); i++)
+		value |= static_cast <uint64_t> (*ptr++) << (i * 8);
+	return static_cast <T> (value);
+}
+
+// Every run takes one byte far past any data of the log as its lock, so
+// the lock never gets in the way of the records themselves. A record is
+// appended under a shared lock, the log is loaded and rewritten under an
+// exclusive one, which waits for appends in progress
+static const DWORD lock_offset_high = 0x7FFFFFFF;
+
+static bool LockLog (HANDLE h, bool exclusive) noexcept
+{
+	OVERLAPPED ov = {};
+	ov.OffsetHigh = lock_offset_high;
+	return ::LockFileEx (h, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &ov) != FALSE;
+}
+
+static BOOL UnlockLog (HANDLE h) noexcept
+{
+	OVERLAPPED ov = {};
+	ov.OffsetHigh = lock_offset_high;
+	return ::UnlockFileEx (h, 0, 1, 0, &ov);
+}
+
+using LogLock = std::unique_ptr <void, decltype (&UnlockLog)>;
+
+static bool ReadLog (HANDLE h, std::vector <unsigned char> & log)
+{
+	LARGE_INTEGER size = {};
+	if (!::GetFileSizeEx (h, &size))
+		return false;
+
+	log.resize (static_cast <size_t> (size.QuadPart));
+	for (size_t done = 0; done < log.size (); )
+	{
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast <DWORD> (done);
+		ov.OffsetHigh = static_cast <DWORD> (static_cast <uint64_t> (done) >> 32);
+
+		DWORD read = 0;
+		DWORD part = static_cast <DWORD> (std::min <size_t> (log.size () - done, 1 << 30));
+		if (!::ReadFile (h, log.data () + done, part, &read, &ov) || 0 == read)
+			return false;
+		done += read;
+	}
+	return true;
+}
+
+static bool WriteLog (HANDLE h, uint64_t offset, const std::vector <unsigned char> & data)
+{
+	for (size_t done = 0; done < data.size (); )
+	{
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast <DWORD> (offset + done);
+		ov.OffsetHigh = static_cast <DWORD> ((offset + done) >> 32);
+
+		DWORD written = 0;
+		DWORD part = static_cast <DWORD> (std::min <size_t> (data.size () - done, 1 << 30));
+		if (!::WriteFile (h, data.data () + done, part, &written, &ov) || 0 == written)
+			return false;
+		done += written;
+	}
+	return true;
+}
+
+static bool TruncateLog (HANDLE h, uint64_t size) noexcept
+{
+	LARGE_INTEGER pos = {};
+	pos.QuadPart = static_cast <LONGLONG> (size);
+	return ::SetFilePointerEx (h, pos, nullptr, FILE_BEGIN) && ::SetEndOfFile (h);
+}
+
+HashCache::HashCache () :
+	m_hlog (nullptr, CloseHandle)
+{
+}
+
+HashCache::~HashCache ()
+{
+	Close ();
+}
+
+bool HashCache::Open (const std::wstring & path) noexcept
+{
+	Close ();
+
+	// other runs may read and append to the log, or compact it, meanwhile
+	HANDLE h = ::CreateFile (path.c_str (), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (INVALID_HANDLE_VALUE == h)
+		return false;
+	m_hlog.reset (h);
+	m_path = path;
+
+	bool loaded = false;
+	try
+	{
+		if (LockLog (h, true))
+		{
+			LogLock lock (h, UnlockLog);
+
+			std::vector <unsigned char> log;
+			size_t complete = 0;
+			if (ReadLog (h, log))
+			{
+				// a new log or one of another version is started over. With
+				// appends excluded, a record cut short was left by a run that
+				// did not finish writing it and is cut off
+				if (!Load (log, m_entries, m_superseded, complete))
+				{
+					m_entries.clear ();
+					loaded = Rewrite ();
+				}
+				else
+					loaded = complete == log.size () || TruncateLog (h, complete);
+			}
+		}
+	}
+	catch (...)
+	{
+	}
+
+	if (!loaded)
+	{
+		m_hlog.reset ();
+		m_entries.clear ();
+		m_superseded = 0;
+	}
+	return loaded;
+}
+
+// Records up to the first one cut short, complete is the end of the last
+// whole one. Fails for a log without the header of this version
+bool HashCache::Load (const std::vector <unsigned char> & log, std::map <Id, Entry> & entries, size_t & superseded, size_t & complete)
+{
+	const unsigned char * ptr = log.data ();
+	const unsigned char * end = ptr + log.size ();
+
+	if (log.size () < sizeof (magic) + 4 || std::memcmp (ptr, magic, sizeof (magic)) != 0)
+		return false;
+	ptr += sizeof (magic);
+	if (Get <uint32_t> (ptr) != m_lVersion)
+		return false;
+
+	for (;;)
+	{
+		complete = static_cast <size_t> (ptr - log.data ());
+		if (static_cast <size_t> (end - ptr) < record_size)
+			break;
+
+		Id id;
+		Entry entry;
+		id.volume = Get <uint32_t> (ptr);
+		id.file_id = Get <uint64_t> (ptr);
+		id.algo = static_cast <HashAlgo> (Get <uint8_t> (ptr));
+		id.tree_chunk = Get <uint64_t> (ptr);
+		entry.size = Get <uint64_t> (ptr);
+		entry.mtime = Get <uint64_t> (ptr);
+		size_t length = Get <uint8_t> (ptr);
+		if (static_cast <size_t> (end - ptr) < length || length > Digest::m_lMaxSize)
+			break;
+		entry.digest = Digest::FromBytes (ptr, length);
+		ptr += length;
+
+		auto res = entries.insert_or_assign (id, std::move (entry));
+		if (!res.second)
+			superseded++;
+	}
+
+	return true;
+}
+
+void HashCache::PutRecord (std::vector <unsigned char> & buffer, const Id & id, const Entry & entry)
+{
+	Put <uint32_t> (buffer, id.volume);
+	Put <uint64_t> (buffer, id.file_id);
+	Put <uint8_t> (buffer, static_cast <uint8_t> (id.algo));
+	Put <uint64_t> (buffer, id.tree_chunk);
+	Put <uint64_t> (buffer, entry.size);
+	Put <uint64_t> (buffer, entry.mtime);
+	Put <uint8_t> (buffer, entry.digest.size);
+	buffer.insert (buffer.end (), entry.digest.data (), entry.digest.data () + entry.digest.size);
+}
+
+// Writes m_entries over the log, in place, so the handles other runs
+// append through stay valid. The header goes last: a log a crash leaves
+// half rewritten has none and is started over. Under the exclusive lock
+bool HashCache::Rewrite () noexcept
+{
+	try
+	{
+		std::vector <unsigned char> header (magic, magic + sizeof (magic));
+		Put <uint32_t> (header, m_lVersion);
+
+		std::vector <unsigned char> buffer (header.size (), 0);
+		for (auto & entry : m_entries)
+			PutRecord (buffer, entry.first, entry.second);
+
+		HANDLE h = m_hlog.get ();
+		if (!WriteLog (h, 0, buffer) || !TruncateLog (h, buffer.size ()) || !::FlushFileBuffers (h) || !WriteLog (h, 0, header))
+			return false;
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	m_superseded = 0;
+	return true;
+}
+
+// Every record this run stored is in the log, next to the ones other runs
+// appended since Open. The log is loaded again and its live records
+// written over it
+bool HashCache::Compact () noexcept
+{
+	HANDLE h = m_hlog.get ();
+	if (!LockLog (h, true))
+		return false;
+	LogLock lock (h, UnlockLog);
+
+	try
+	{
+		std::vector <unsigned char> log;
+		std::map <Id, Entry> entries;
+		size_t superseded = 0, complete = 0;
+		if (!ReadLog (h, log) || !Load (log, entries, superseded, complete))
+			return false;
+
+		m_entries.swap (entries);
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	return Rewrite ();
+}
+
+void HashCache::Close () noexcept
+{
+	std::unique_lock <std::shared_mutex> lk (m_lock);
+	if (nullptr == m_hlog)
+		return;
+
+	if (m_superseded > m_entries.size ())
+		Compact ();
+
+	m_hlog.reset ();
+	m_entries.clear ();
+	m_superseded = 0;
+}
+
+bool HashCache::GetKey (const wchar_t * path, Key & key) noexcept
+{
+	// metadata only, the file is not opened for reading
+	HANDLE h = ::CreateFile (path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (INVALID_HANDLE_VALUE == h)
+		return false;
+	std::unique_ptr <void, decltype (&CloseHandle)> hfile (h, CloseHandle);
+
+	BY_HANDLE_FILE_INFORMATION info = {};
+	if (!::GetFileInformationByHandle (hfile.get (), &info))
+		return false;
+
+	key.volume = info.dwVolumeSerialNumber;
+	key.file_id = (static_cast <uint64_t> (info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+	key.size = (static_cast <uint64_t> (info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+	key.mtime = (static_cast <uint64_t> (info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+bool HashCache::Find (const Key & key, HashAlgo algo, uint64_t tree_chunk, Digest & digest) const
+{
+	std::shared_lock <std::shared_mutex> lk (m_lock);
+	auto it = m_entries.find ({ key.volume, key.file_id, algo, tree_chunk });
+	if (it == m_entries.end () || it->second.size != key.size || it->second.mtime != key.mtime)
+		return false;
+
+	digest = it->second.digest;
+	return true;
+}
+
+void HashCache::Store (const Key & key, HashAlgo algo, uint64_t tree_chunk, const Digest & digest)
+{
+	Id id = { key.volume, key.file_id, algo, tree_chunk };
+	Entry entry = { key.size, key.mtime, digest };
+
+	std::vector <unsigned char> record;
+	PutRecord (record, id, entry);
+
+	std::unique_lock <std::shared_mutex> lk (m_lock);
+	if (nullptr == m_hlog || !LockLog (m_hlog.get (), false))
+		return;
+	LogLock lock (m_hlog.get (), UnlockLog);
+
+	// a whole record in one write at the end of the log, wherever other
+	// runs have taken it meanwhile
+	OVERLAPPED ov = {};
+	ov.Offset = 0xFFFFFFFF;
+	ov.OffsetHigh = 0xFFFFFFFF;
+	DWORD written = 0;
+	if (!::WriteFile (m_hlog.get (), record.data (), static_cast <DWORD> (record.size ()), &written, &ov) || written != record.size ())
+		return;
+
+	auto res = m_entries.insert_or_assign (id, std::move (entry));
+	if (!res.second)
+		m_superseded++;
+}
@@ -0,0 +1,76 @@
+
+#pragma once
+#include "hasher.h"
+
+// Hashes of files kept on disk between runs. The cache file is an append
+// log of records, loaded into a map on Open. A record holds the volume
+// serial number and the file index, which identify a file on NTFS, the
+// kind of hash and the size and last write time the hash is valid for.
+// A newer record of a file supersedes the older ones, Close compacts the
+// log once there are more superseded records than live ones. Several runs
+// may use one log at once: records are appended and the log compacted in
+// place, under a lock on the file. Lookups take a shared lock, so any
+// number of hashing threads read at once
+class HashCache
+{
+public:
+	struct Key
+	{
+		uint32_t volume = 0;
+		uint64_t file_id = 0;
+		uint64_t size = 0;
+		uint64_t mtime = 0;
+	};
+
+private:
+	static const uint32_t m_lVersion = 2;
+
+	// the file and the kind of its hash
+	struct Id
+	{
+		uint32_t volume;
+		uint64_t file_id;
+		HashAlgo algo;
+		uint64_t tree_chunk;
+
+		bool operator < (const Id & id) const noexcept
+		{
+			return std::tie (volume, file_id, algo, tree_chunk) < std::tie (id.volume, id.file_id, id.algo, id.tree_chunk);
+		}
+	};
+
+	struct Entry
+	{
+		uint64_t size;
+		uint64_t mtime;
+		Digest digest;
+	};
+
+	std::wstring m_path;
+	std::unique_ptr <void, decltype (&CloseHandle)> m_hlog;
+	mutable std::shared_mutex m_lock;
+	std::map <Id, Entry> m_entries;
+	size_t m_superseded = 0;
+
+public:
+	HashCache ();
+	~HashCache ();
+
+	HashCache (const HashCache &) = delete;
+	HashCache & operator = (const HashCache &) = delete;
+
+	// loads the cache file, creates it if there is none
+	bool Open (const std::wstring & path) noexcept;
+	void Close () noexcept;
+
+	static bool GetKey (const wchar_t * path, Key & key) noexcept;
+
+	bool Find (const Key & key, HashAlgo algo, uint64_t tree_chunk, Digest & digest) const;
+	void Store (const Key & key, HashAlgo algo, uint64_t tree_chunk, const Digest & digest);
+
+private:
+	static bool Load (const std::vector <unsigned char> & log, std::map <Id, Entry> & entries, size_t & superseded, size_t & complete);
+	bool Rewrite () noexcept;
+	bool Compact () noexcept;
+	static void PutRecord (std::vector <unsigned char> & buffer, const Id & id, const Entry & entry);
+};
@@ -0,0 +1,132 @@
+
+#include "pch.h"
+#include "hasher.h"
+#include "sha1.h"
+#include "sha256.h"
+#include "xxh3.h"
+
+static const struct
+{
+	HashAlgo algo;
+	const wchar_t * name;
+	size_t digest_size;
+}
+algos [] =
+{
+	{ HashAlgo::sha1, L"sha1", 20 },
+	{ HashAlgo::sha256, L"sha256", 32 },
+	{ HashAlgo::xxh3, L"xxh3", 16 },
+};
+
+bool ParseHashAlgo (std::wstring_view name, HashAlgo & algo) noexcept
+{
+	for (auto & a : algos)
+	{
+		std::wstring_view n (a.name);
+		if (n.size () == name.size () && std::equal (n.begin (), n.end (), name.begin (),
+			[](wchar_t c1, wchar_t c2) { return std::towlower (c1) == std::towlower (c2); }))
+		{
+			algo = a.algo;
+			return true;
+		}
+	}
+	return false;
+}
+
+const wchar_t * GetHashAlgoName (HashAlgo algo) noexcept
+{
+	for (auto & a : algos)
+	{
+		if (a.algo == algo)
+			return a.name;
+	}
+	return L"";
+}
+
+size_t GetHashAlgoDigestSize (HashAlgo algo) noexcept
+{
+	for (auto & a : algos)
+	{
+		if (a.algo == algo)
+			return a.digest_size;
+	}
+	return 0;
+}
+
+void Hasher::ComputeHash (const unsigned char * data, uintmax_t size) noexcept
+{
+	Update (data, size);
+	Finalize ();
+}
+
+Digest Hasher::Result () const noexcept
+{
+	Digest digest;
+	digest.size = static_cast <uint8_t> (std::min (GetDigestSize (), Digest::m_lMaxSize));
+	GetDigest (digest.bytes.data ());
+	return digest;
+}
+
+Digest Digest::FromBytes (const unsigned char * data, size_t size) noexcept
+{
+	Digest digest;
+	digest.size = static_cast <uint8_t> (std::min (size, m_lMaxSize));
+	std::memcpy (digest.bytes.data (), data, digest.size);
+	return digest;
+}
+
+bool Digest::FromHex (std::wstring_view hex, Digest & digest) noexcept
+{
+	if (hex.empty () || hex.size () % 2 != 0 || hex.size () > m_lMaxSize * 2)
+		return false;
+
+	auto Nibble = [](wchar_t c) -> int
+	{
+		if (c >= L'0' && c <= L'9')
+			return c - L'0';
+		if (c >= L'a' && c <= L'f')
+			return c - L'a' + 10;
+		if (c >= L'A' && c <= L'F')
+			return c - L'A' + 10;
+		return -1;
+	};
+
+	Digest res;
+	res.size = static_cast <uint8_t> (hex.size () / 2);
+	for (size_t i = 0; i < res.size; i++)
+	{
+		int hi = Nibble (hex [i * 2]), lo = Nibble (hex [i * 2 + 1]);
+		if (hi < 0 || lo < 0)
+			return false;
+		res.bytes [i] = static_cast <unsigned char> (hi << 4 | lo);
+	}
+
+	digest = res;
+	return true;
+}
+
+std::wstring Digest::ToHex () const
+{
+	static const wchar_t digits [] = L"0123456789ABCDEF";
+
+	std::wstring hex (size * 2, L'0');
+	for (size_t i = 0; i < size; i++)
+	{
+		hex [i * 2] = digits [bytes [i] >> 4];
+		hex [i * 2 + 1] = digits [bytes [i] & 0x0f];
+	}
+	return hex;
+}
+
+std::unique_ptr <Hasher> Hasher::Create (HashAlgo algo)
+{
+	switch (algo)
+	{
+	case HashAlgo::sha256:
+		return std::make_unique <Sha256> ();
+	case HashAlgo::xxh3:
+		return std::make_unique <Xxh3> ();
+	default:
+		return std::make_unique <Sha1> ();
+	}
+}
@@ -0,0 +1,73 @@
+
+#pragma once
+
+// Hash algorithms files can be hashed with. sha1 and sha256 are for hashes
+// people look up and compare with other tools, xxh3 (XXH3-128) is a fast
+// non-cryptographic hash, good enough to find duplicates at disk speed
+enum class HashAlgo
+{
+	sha1,
+	sha256,
+	xxh3
+};
+
+// names as given on the command line, case-insensitive
+bool ParseHashAlgo (std::wstring_view name, HashAlgo & algo) noexcept;
+const wchar_t * GetHashAlgoName (HashAlgo algo) noexcept;
+size_t GetHashAlgoDigestSize (HashAlgo algo) noexcept;
+
+// A digest of any of the algorithms, kept binary. Hex is made only to print
+// it or read it from the command line
+struct Digest
+{
+	static const size_t m_lMaxSize = 32;
+
+	std::array <unsigned char, m_lMaxSize> bytes = {};
+	uint8_t size = 0;
+
+	inline bool empty () const noexcept
+	{
+		return 0 == size;
+	}
+
+	inline const unsigned char * data () const noexcept
+	{
+		return bytes.data ();
+	}
+
+	inline bool operator == (const Digest & digest) const noexcept
+	{
+		return size == digest.size && bytes == digest.bytes;
+	}
+
+	inline bool operator < (const Digest & digest) const noexcept
+	{
+		return std::tie (size, bytes) < std::tie (digest.size, digest.bytes);
+	}
+
+	static Digest FromBytes (const unsigned char * data, size_t size) noexcept;
+	// uppercase or lowercase hex of at most m_lMaxSize bytes
+	static bool FromHex (std::wstring_view hex, Digest & digest) noexcept;
+	// uppercase hex
+	std::wstring ToHex () const;
+};
+
+// Common interface of the hash algorithms. Data may come in any number of
+// Update calls, GetDigest is valid after Finalize
+class Hasher
+{
+public:
+	virtual ~Hasher () = default;
+
+	virtual void Update (const unsigned char * data, uintmax_t size) noexcept = 0;
+	virtual void Finalize () noexcept = 0;
+
+	virtual size_t GetDigestSize () const noexcept = 0;
+	virtual void GetDigest (unsigned char * buffer) const noexcept = 0;
+
+	void ComputeHash (const unsigned char * data, uintmax_t size) noexcept;
+
+	Digest Result () const noexcept;
+
+	static std::unique_ptr <Hasher> Create (HashAlgo algo);
+};
@@ -0,0 +1,307 @@
+
+#include "pch.h"
+#include "MaskSet.h"
+
+void MaskSet::Add (const std::list <std::wstring> & masks)
+{
+	bool generic_added = false;
+
+	for (auto & mask : masks)
+	{
+		GlobMask glob (mask);
+
+		auto wildcard = glob.Mask ().find_first_of (L"*?");
+		m_leads.emplace_back (glob.Mask ().substr (0, wildcard), std::wstring::npos != wildcard);
+
+		switch (glob.Type ())
+		{
+		case GlobMask::Kind::any:
+			m_any = true;
+			break;
+		case GlobMask::Kind::literal:
+			m_literal.insert (glob.Mask ());
+			break;
+		case GlobMask::Kind::prefix:
+			AddToTable (m_prefix, glob.Mask ().substr (0, glob.Mask ().size () - 1));
+			break;
+		case GlobMask::Kind::suffix:
+			AddToTable (m_suffix, glob.Mask ().substr (1));
+			break;
+		default:
+			m_generic.push_back (std::move (glob));
+			generic_added = true;
+		}
+	}
+
+	if (generic_added)
+		BuildAutomaton ();
+}
+
+void MaskSet::AddToTable (std::vector <std::pair <size_t, Table>> & tables, std::wstring && key)
+{
+	size_t len = key.size ();
+	auto it = std::lower_bound (tables.begin (), tables.end (), len,
+		[](const std::pair <size_t, Table> & t, size_t len)
+		{
+			return t.first < len;
+		}
+	);
+
+	if (it == tables.end () || it->first != len)
+		it = tables.insert (it, { len, Table () });
+
+	it->second.insert (std::move (key));
+}
+
+bool MaskSet::Empty () const noexcept
+{
+	return !m_any && m_literal.empty () && m_prefix.empty () && m_suffix.empty () && m_generic.empty ();
+}
+
+void MaskSet::BuildAutomaton ()
+{
+	m_symbol.clear ();
+	m_first.clear ();
+	if (m_generic.size () <= m_lLinearLimit)
+		return;
+
+	// masks starting with the same symbol get adjacent states, so the ones a
+	// name can start with form one short run of words. Masks starting with a
+	// wildcard go first and are always started
+	std::stable_sort (m_generic.begin (), m_generic.end (),
+		[](const GlobMask & m1, const GlobMask & m2)
+		{
+			auto Key = [](const GlobMask & m)
+			{
+				wchar_t c = m.Mask ().front ();
+				return (L'*' == c || L'?' == c) ? 0 : (uint32_t)c + 1;
+			};
+			return Key (m1) < Key (m2);
+		}
+	);
+
+	// one state per mask symbol plus the accepting state behind each mask
+	size_t states = 0;
+	for (auto & glob : m_generic)
+		states += glob.Mask ().size () + 1;
+
+	m_words = (states + 63) / 64;
+	m_start.assign (m_words, 0);
+	m_star.assign (m_words, 0);
+	m_accept.assign (m_words, 0);
+	m_question.assign (m_words, 0);
+	m_wild_words = 0;
+
+	auto Set = [](Bits & bits, size_t n)
+	{
+		bits [n / 64] |= (uint64_t)1 << (n % 64);
+	};
+
+	size_t n = 0;
+	for (auto & glob : m_generic)
+	{
+		wchar_t first = glob.Mask ().front ();
+		size_t first_word = n / 64;
+		size_t last_word = (n + glob.Mask ().size ()) / 64;
+
+		if (L'*' == first || L'?' == first)
+		{
+			m_wild_words = last_word + 1;
+		}
+		else
+		{
+			auto it = m_first.find (first);
+			if (it == m_first.end ())
+				m_first.emplace (first, std::make_pair (first_word, last_word + 1));
+			else
+				it->second.second = last_word + 1;
+		}
+
+		Set (m_start, n);
+		for (auto c : glob.Mask ())
+		{
+			if (L'*' == c)
+				Set (m_star, n);
+			else if (L'?' == c)
+				Set (m_question, n);
+			else
+			{
+				auto it = m_symbol.find (c);
+				if (it == m_symbol.end ())
+					it = m_symbol.emplace (c, Bits (m_words, 0)).first;
+				Set (it->second, n);
+			}
+			n++;
+		}
+		Set (m_accept, n++);
+	}
+
+	for (auto & symbol : m_symbol)
+	{
+		for (size_t i = 0; i < m_words; i++)
+			symbol.second [i] |= m_question [i];
+	}
+}
+
+bool MaskSet::MatchAutomaton (std::wstring_view str) const noexcept
+{
+	if (str.empty ())
+	{
+		// only masks made of '*' alone could match, and GlobMask keeps them apart
+		return false;
+	}
+
+	// only words holding live states are visited, kept as a sorted list.
+	// Both state vectors are all zeroes between calls
+	thread_local Bits active, next;
+	thread_local std::vector <size_t> live, next_live;
+	if (active.size () <= m_words)
+	{
+		active.resize (m_words + 1, 0);
+		next.resize (m_words + 1, 0);
+	}
+	live.clear ();
+
+	auto StartRange = [this](size_t from, size_t to)
+	{
+		for (size_t i = from; i < to && i < m_words; i++)
+		{
+			if (live.empty () || live.back () < i)
+				live.push_back (i);
+			active [i] = m_start [i];
+		}
+	};
+
+	StartRange (0, m_wild_words);
+	auto first = m_first.find (FoldCase (str.front ()));
+	if (first != m_first.end ())
+		StartRange (first->second.first, first->second.second);
+
+	// '*' may match nothing: an active star activates the symbol behind it.
+	// Runs of '*' are collapsed by GlobMask and a star is never followed by
+	// another one, so a single step is enough
+	auto Closure = [this](Bits & bits, std::vector <size_t> & words)
+	{
+		size_t count = words.size ();
+		for (size_t k = 0; k < count; k++)
+		{
+			size_t i = words [k];
+			uint64_t stars = bits [i] & m_star [i];
+			bits [i] |= stars << 1;
+			if ((stars >> 63) != 0)
+			{
+				bits [i + 1] |= 1;
+				if (k + 1 == count || words [k + 1] != i + 1)
+					words.push_back (i + 1);
+			}
+		}
+		std::sort (words.begin () + count, words.end ());
+		std::inplace_merge (words.begin (), words.begin () + count, words.end ());
+	};
+
+	Closure (active, live);
+
+	for (auto c : str)
+	{
+		auto it = m_symbol.find (FoldCase (c));
+		const Bits & accepts = (it != m_symbol.end () ? it->second : m_question);
+
+		next_live.clear ();
+		for (auto i : live)
+		{
+			uint64_t moved = active [i] & accepts [i];
+			uint64_t value = (moved << 1) | (active [i] & m_star [i]);
+			active [i] = 0;
+
+			next [i] |= value;
+			if (next [i] != 0 && (next_live.empty () || next_live.back () != i))
+				next_live.push_back (i);
+
+			if ((moved >> 63) != 0 && i + 1 < m_words)
+			{
+				next [i + 1] |= 1;
+				next_live.push_back (i + 1);
+			}
+		}
+
+		if (next_live.empty ())
+			return false;
+
+		Closure (next, next_live);
+		active.swap (next);
+		live.swap (next_live);
+	}
+
+	bool matched = false;
+	for (auto i : live)
+	{
+		if (active [i] & m_accept [i])
+			matched = true;
+		active [i] = 0;
+	}
+	return matched;
+}
+
+bool MaskSet::Match (std::wstring_view str) const noexcept
+{
+	if (m_any)
+		return true;
+
+	if (!m_literal.empty () && m_literal.find (str) != m_literal.end ())
+		return true;
+
+	for (auto & table : m_prefix)
+	{
+		if (table.first > str.size ())
+			break;
+		if (table.second.find (str.substr (0, table.first)) != table.second.end ())
+			return true;
+	}
+
+	for (auto & table : m_suffix)
+	{
+		if (table.first > str.size ())
+			break;
+		if (table.second.find (str.substr (str.size () - table.first)) != table.second.end ())
+			return true;
+	}
+
+	if (m_generic.empty ())
+		return false;
+
+	if (m_generic.size () <= m_lLinearLimit)
+	{
+		for (auto & glob : m_generic)
+		{
+			if (glob.Match (str))
+				return true;
+		}
+		return false;
+	}
+
+	return MatchAutomaton (str);
+}
+
+bool MaskSet::MayMatchUnder (std::wstring_view dir, wchar_t separator) const noexcept
+{
+	FoldedEqual equal;
+
+	for (auto & lead : m_leads)
+	{
+		std::wstring_view l (lead.first);
+
+		// the path is already inside the literal part: only a wildcard mask may go on
+		if (l.size () <= dir.size ())
+		{
+			if (lead.second ? equal (dir.substr (0, l.size ()), l) : equal (dir, l))
+				return true;
+			continue;
+		}
+
+		// the literal part goes deeper than the path, through a separator
+		if (l [dir.size ()] == separator && equal (l.substr (0, dir.size ()), dir))
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,58 @@
+
+#pragma once
+#include "Glob.h"
+#include "CaseFold.h"
+
+// Set of file masks that answers "does any of them match" in one pass over
+// the string, whatever the number of masks is.
+// Plain names and masks of "abc*" and "*.txt" form go to hash tables, one
+// table per prefix/suffix length, so they cost a lookup per distinct length.
+// The remaining masks are merged into a single NFA, simulated bit-parallel:
+// every mask symbol is a bit and one step over the input updates all masks at
+// once. Only words holding live states are visited, and masks are laid out by
+// their first symbol, so a name touches only the masks that can still match
+// it. A couple of such masks are cheaper to try one by one, so the automaton
+// is used only when there are more of them
+class MaskSet
+{
+	using Bits = std::vector <uint64_t>;
+	using Table = std::unordered_set <std::wstring, FoldedHash, FoldedEqual>;
+
+	static const size_t m_lLinearLimit = 4;
+
+	bool m_any = false;
+	Table m_literal;
+	std::vector <std::pair <size_t, Table>> m_prefix;		// sorted by length
+	std::vector <std::pair <size_t, Table>> m_suffix;		// sorted by length
+	std::vector <GlobMask> m_generic;
+
+	// literal lead of every mask, up to its first wildcard, and whether the
+	// mask goes on past it
+	std::vector <std::pair <std::wstring, bool>> m_leads;
+
+	// merged automaton for m_generic
+	size_t m_words = 0;
+	Bits m_start;
+	Bits m_star;
+	Bits m_accept;
+	Bits m_question;
+	std::unordered_map <wchar_t, Bits> m_symbol;		// symbol bits | m_question
+	size_t m_wild_words = 0;							// words of masks starting with a wildcard
+	std::unordered_map <wchar_t, std::pair <size_t, size_t>> m_first;	// words of masks starting with a symbol
+
+public:
+	void Add (const std::list <std::wstring> & masks);
+
+	bool Empty () const noexcept;
+	// case-insensitive, the string is searched as it is
+	bool Match (std::wstring_view str) const noexcept;
+
+	// whether some mask may match dir itself or a path below it, judged by
+	// the literal leads of the masks. False means the subtree can be skipped
+	bool MayMatchUnder (std::wstring_view dir, wchar_t separator) const noexcept;
+
+private:
+	void AddToTable (std::vector <std::pair <size_t, Table>> & tables, std::wstring && key);
+	void BuildAutomaton ();
+	bool MatchAutomaton (std::wstring_view str) const noexcept;
+};
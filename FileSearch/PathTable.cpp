@@ -0,0 +1,169 @@
+
+#include "pch.h"
+#include "pathtable.h"
+
+#ifdef _WIN32
+static const PathTable::Char separators [] = L"\\/";
+#else
+static const PathTable::Char separators [] = "/";
+#endif
+
+std::atomic <uint64_t> PathTable::m_last_id { 0 };
+thread_local PathTable::Cursor PathTable::m_cursor;
+
+PathTable::PathTable () :
+	m_id (++m_last_id)
+{
+}
+
+PathTable::~PathTable ()
+{
+	for (auto & block : m_blocks)
+		delete [] block.load (std::memory_order_relaxed);
+
+	Chunk * chunk = m_chunks.load (std::memory_order_acquire);
+	while (chunk != nullptr)
+	{
+		Chunk * next = chunk->next;
+		delete chunk;
+		chunk = next;
+	}
+}
+
+PathTable::Cursor & PathTable::GetCursor () noexcept
+{
+	Cursor & cursor = m_cursor;
+	if (cursor.table != m_id)
+	{
+		cursor.table = m_id;
+		cursor.chunk = nullptr;
+		cursor.dir.clear ();
+		cursor.dir_id = m_lNone;
+	}
+	return cursor;
+}
+
+// copies name to the thread's arena chunk, a full chunk is left as it is
+// and a new one linked into the table with a compare-and-swap
+const PathTable::Char * PathTable::Store (Cursor & cursor, View name)
+{
+	if (nullptr == cursor.chunk || cursor.chunk->size - cursor.chunk->used < name.size ())
+	{
+		auto chunk = std::make_unique <Chunk> ();
+		chunk->size = std::max (m_lChunkSize, name.size ());
+		chunk->data.reset (new Char [chunk->size]);
+
+		chunk->next = m_chunks.load (std::memory_order_relaxed);
+		while (!m_chunks.compare_exchange_weak (chunk->next, chunk.get (), std::memory_order_release, std::memory_order_relaxed))
+			;
+		cursor.chunk = chunk.release ();
+	}
+
+	Char * stored = cursor.chunk->data.get () + cursor.chunk->used;
+	std::copy (name.begin (), name.end (), stored);
+	cursor.chunk->used += name.size ();
+	return stored;
+}
+
+PathTable::Id PathTable::Intern (Cursor & cursor, Id parent, View name)
+{
+	Key key { parent, name };
+	{
+		std::shared_lock <std::shared_mutex> lock (m_lock);
+		auto it = m_index.find (key);
+		if (it != m_index.end ())
+			return it->second;
+	}
+
+	std::unique_lock <std::shared_mutex> lock (m_lock);
+	auto it = m_index.find (key);
+	if (it != m_index.end ())
+		return it->second;
+
+	Id id = m_count.load (std::memory_order_relaxed);
+	size_t block, pos;
+	Locate (id, block, pos);
+	if (block >= m_lBlocks)
+		throw std::length_error ("too many directories");
+
+	Entry * entries = m_blocks [block].load (std::memory_order_relaxed);
+	if (nullptr == entries)
+	{
+		entries = new Entry [m_lFirstBlock << block];
+		m_blocks [block].store (entries, std::memory_order_relaxed);
+	}
+
+	const Char * stored = Store (cursor, name);
+	m_index.emplace (Key { parent, View (stored, name.size ()) }, id);
+	entries [pos] = { parent, static_cast <uint32_t> (name.size ()), stored };
+	// the entry, and its block if new, before the id is handed out
+	m_count.store (id + 1, std::memory_order_release);
+	return id;
+}
+
+// dir ends with a separator, every name is interned with the one after it
+PathTable::Id PathTable::InternDirectory (Cursor & cursor, View dir)
+{
+	Id parent = m_lNone;
+	for (size_t start = 0; start < dir.size (); )
+	{
+		size_t end = dir.find_first_of (separators, start);
+		parent = Intern (cursor, parent, dir.substr (start, end + 1 - start));
+		start = end + 1;
+	}
+	return parent;
+}
+
+PathTable::Ref PathTable::Add (const std::filesystem::path & path)
+{
+	Cursor & cursor = GetCursor ();
+
+	View native (path.native ());
+	size_t pos = native.find_last_of (separators);
+	View name = View::npos == pos ? native : native.substr (pos + 1);
+
+	Ref ref;
+	if (View::npos != pos)
+	{
+		// files come directory by directory, most have the directory of
+		// the previous file of the thread
+		View dir = native.substr (0, pos + 1);
+		if (m_lNone == cursor.dir_id || dir != cursor.dir)
+		{
+			Id id = InternDirectory (cursor, dir);
+			cursor.dir.assign (dir);
+			cursor.dir_id = id;
+		}
+		ref.dir = cursor.dir_id;
+	}
+
+	ref.name = Store (cursor, name);
+	ref.length = static_cast <uint32_t> (name.size ());
+	return ref;
+}
+
+PathTable::String PathTable::Build (const Ref & ref) const
+{
+	if (m_lNone == ref.dir)
+		return String (ref.Name ());
+
+	// pairs with the release store of Intern, every id handed out is
+	// below the count and so are the parents of its entry
+	m_count.load (std::memory_order_acquire);
+
+	size_t length = ref.length;
+	for (Id id = ref.dir; id != m_lNone; id = At (id).parent)
+		length += At (id).length;
+
+	// names from the file up, each in front of the one before
+	String path (length, Char ());
+	size_t pos = length - ref.length;
+	std::copy (ref.name, ref.name + ref.length, path.begin () + pos);
+	for (Id id = ref.dir; id != m_lNone; id = At (id).parent)
+	{
+		const Entry & entry = At (id);
+		pos -= entry.length;
+		std::copy (entry.name, entry.name + entry.length, path.begin () + pos);
+	}
+	return path;
+}
@@ -0,0 +1,137 @@
+
+#pragma once
+
+// Paths kept as a tree of names instead of whole strings. A directory is
+// an entry of its parent and its name, interned once however many files it
+// holds; a file is just the id of its directory and its own name. Names are
+// stored in the native encoding in chunks of an arena that never move, each
+// with the separator that followed it in the path, so a rebuilt path is the
+// one added, separators and all. Full paths are built only when a file is
+// printed or opened, with no lock: directory entries are kept in blocks
+// that never move either and published by a release store of their count
+class PathTable
+{
+public:
+	using Id = uint32_t;
+	using Char = std::filesystem::path::value_type;
+	using String = std::filesystem::path::string_type;
+	using View = std::basic_string_view <Char>;
+
+	static constexpr Id m_lNone = (Id)-1;				// no directory, the parent of roots
+	static const size_t m_lChunkSize = 64 * 1024;		// characters of an arena chunk
+	static const size_t m_lFirstBlock = 1024;			// entries of the first block, each next one has twice as many
+	static const size_t m_lBlocks = 22;					// enough for all but the last m_lFirstBlock ids
+
+	// what a file keeps of its path, 16 bytes on x64
+	struct Ref
+	{
+		Id dir = m_lNone;
+		uint32_t length = 0;
+		const Char * name = nullptr;
+
+		inline View Name () const noexcept
+		{
+			return View (name, length);
+		}
+	};
+
+private:
+	struct Entry
+	{
+		Id parent;
+		uint32_t length;
+		const Char * name;
+	};
+
+	struct Key
+	{
+		Id parent;
+		View name;
+
+		inline bool operator == (const Key & key) const noexcept
+		{
+			return parent == key.parent && name == key.name;
+		}
+	};
+
+	struct KeyHash
+	{
+		inline size_t operator () (const Key & key) const noexcept
+		{
+			return std::hash <View> () (key.name) ^ (static_cast <size_t> (key.parent) * 0x9e3779b9u);
+		}
+	};
+
+	struct Chunk
+	{
+		Chunk * next = nullptr;
+		size_t size = 0;
+		size_t used = 0;
+		std::unique_ptr <Char []> data;
+	};
+
+	// the arena chunk a thread appends names to and the directory of the
+	// last file it added, for the table they were taken for
+	struct Cursor
+	{
+		uint64_t table = 0;
+		Chunk * chunk = nullptr;
+		String dir;
+		Id dir_id = m_lNone;
+	};
+
+	static std::atomic <uint64_t> m_last_id;
+	static thread_local Cursor m_cursor;
+
+	const uint64_t m_id;
+	std::atomic <Chunk *> m_chunks { nullptr };
+
+	mutable std::shared_mutex m_lock;					// guards m_index and the adding of entries
+	std::atomic <Entry *> m_blocks [m_lBlocks] = {};
+	std::atomic <Id> m_count { 0 };						// entries published
+	std::unordered_map <Key, Id, KeyHash> m_index;
+
+	// the block of an id and its place in it
+	static inline void Locate (Id id, size_t & block, size_t & pos) noexcept
+	{
+		size_t n = id / m_lFirstBlock + 1;
+		block = std::bit_width (n) - 1;
+		pos = id - m_lFirstBlock * ((size_t (1) << block) - 1);
+	}
+
+	inline const Entry & At (Id id) const noexcept
+	{
+		size_t block, pos;
+		Locate (id, block, pos);
+		return m_blocks [block].load (std::memory_order_relaxed) [pos];
+	}
+
+	Cursor & GetCursor () noexcept;
+	const Char * Store (Cursor & cursor, View name);
+	Id InternDirectory (Cursor & cursor, View dir);
+	Id Intern (Cursor & cursor, Id parent, View name);
+
+public:
+	PathTable ();
+	~PathTable ();
+
+	PathTable (const PathTable &) = delete;
+	PathTable & operator = (const PathTable &) = delete;
+
+	// any number of threads at once
+	Ref Add (const std::filesystem::path & path);
+	// the path as it was added
+	String Build (const Ref & ref) const;
+
+	inline size_t Directories () const noexcept
+	{
+		return m_count.load (std::memory_order_acquire);
+	}
+
+	// Files of one directory next to each other, directories in the order
+	// they were first seen. Not the order of the path strings
+	static inline bool Before (const Ref & r1, const Ref & r2) noexcept
+	{
+		return r1.dir != r2.dir ? r1.dir < r2.dir : r1.Name () < r2.Name ();
+	}
+};
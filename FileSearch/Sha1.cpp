@@ -2,38 +2,24 @@
 #include "pch.h"
 #include "sha1.h"
 
+std::atomic <Sha1Kernel> Sha1::m_kernel { SelectSha1Kernel () };
+
 Sha1::Sha1 ()
 {
 	Reset ();
 }
 
-void Sha1::ComputeHash (const unsigned char* data, uintmax_t size) noexcept
+Sha1Kernel Sha1::GetKernel () noexcept
 {
-	Update (data, size);
-	Finalize ();
+	return m_kernel;
 }
 
-char Sha1::HexDigit (unsigned char b) const noexcept
+bool Sha1::SetKernel (Sha1Kernel kernel) noexcept
 {
-	if (b <= 9)
-		return '0' + b;
-	return 'A' + b - 0xa;
-}
-
-std::string Sha1::GetReport () const noexcept
-{
-	std::stringstream report;
-
-	std::vector <unsigned char> digest (GetDigestSize ());
-	GetDigest (&digest [0]);
-
-	for (size_t i = 0; i < digest.size (); i++)
-	{
-		report << HexDigit (digest [i] >> 4);
-		report << HexDigit (digest [i] & 0x0f);
-	}
-
-	return report.str ();
+	if (!IsSha1KernelSupported (kernel))
+		return false;
+	m_kernel = kernel;
+	return true;
 }
 
 void Sha1::Update (const unsigned char * data, uintmax_t size) noexcept
@@ -44,28 +30,36 @@ void Sha1::Update (const unsigned char * data, uintmax_t size) noexcept
 	if (m_bIsFinal)
 		return;
 
-	bool corrupted = false;
+	auto process = GetSha1BlockFunc (m_kernel);
+	m_lLength += size;
 
-	while (size-- && !corrupted)
+	// complete a block left from the previous call first
+	if (m_lMessageBlock > 0)
 	{
-		m_pMessageBlock [m_lMessageBlock++] = (*data & 0xFF);
-
-		m_lBitsLow += 8;
-		m_lBitsLow &= 0xFFFFFFFF;				// Force it to 32 bits
-		
-		if (0 == m_lBitsLow)
-		{
-			m_lBitsHigh++;
-			m_lBitsHigh &= 0xFFFFFFFF;			// Force it to 32 bits
-			if (0 == m_lBitsHigh)
-				corrupted = true;				// Message is too long
-		}
-
-		if (64 == m_lMessageBlock)
-			ProcessMessageBlock ();
-
-		data++;
+		size_t part = static_cast <size_t> (std::min <uintmax_t> (64 - m_lMessageBlock, size));
+		std::memcpy (m_pMessageBlock + m_lMessageBlock, data, part);
+		m_lMessageBlock += part;
+		data += part;
+		size -= part;
+
+		if (m_lMessageBlock < 64)
+			return;
+
+		process (m_digest, m_pMessageBlock, 1);
+		m_lMessageBlock = 0;
 	}
+
+	// whole blocks straight from the input
+	uintmax_t blocks = size / 64;
+	if (blocks > 0)
+	{
+		process (m_digest, data, static_cast <size_t> (blocks));
+		data += blocks * 64;
+		size -= blocks * 64;
+	}
+
+	std::memcpy (m_pMessageBlock, data, static_cast <size_t> (size));
+	m_lMessageBlock = static_cast <size_t> (size);
 }
 
 void Sha1::Finalize () noexcept
@@ -76,8 +70,7 @@ void Sha1::Finalize () noexcept
 
 void Sha1::Reset () noexcept
 {
-	m_lBitsLow = 0;
-	m_lBitsHigh = 0;
+	m_lLength = 0;
 	m_lMessageBlock = 0;
 
 	m_digest [0] = 0x67452301;
@@ -97,148 +90,40 @@ void Sha1::GetDigest (unsigned char * buffer) const noexcept
 	if (!m_bIsFinal)
 		return;
 
-	const unsigned char * digest = reinterpret_cast <const unsigned char *> (m_digest);
-	const size_t sizeOfInt = sizeof (m_digest [0]);
-
-	for (size_t i = 0; i < m_lDigestSize; i += sizeOfInt)
+	for (size_t i = 0; i < m_lDigestSize / 4; i++)
 	{
-		for (size_t j = 0; j < sizeOfInt; j++)
-		{
-			buffer [i + j] = digest [i + sizeOfInt - 1 - j];
-		}
+		buffer [i * 4] = static_cast <unsigned char> (m_digest [i] >> 24);
+		buffer [i * 4 + 1] = static_cast <unsigned char> (m_digest [i] >> 16);
+		buffer [i * 4 + 2] = static_cast <unsigned char> (m_digest [i] >> 8);
+		buffer [i * 4 + 3] = static_cast <unsigned char> (m_digest [i]);
 	}
 }
 
-void Sha1::ProcessMessageBlock () noexcept
-{
-	// Constants defined for SHA-1
-	const size_t K [] =
-	{
-		0x5A827999,
-		0x6ED9EBA1,
-		0x8F1BBCDC,
-		0xCA62C1D6
-	};
-
-	size_t W[80] = {};		// Word sequence	
-
-	for (size_t t = 0; t < 16; t++)
-	{
-		W [t] = ((size_t) m_pMessageBlock [t * 4]) << 24;
-		W [t] |= ((size_t) m_pMessageBlock [t * 4 + 1]) << 16;
-		W [t] |= ((size_t) m_pMessageBlock [t * 4 + 2]) << 8;
-		W [t] |= ((size_t) m_pMessageBlock [t * 4 + 3]);
-	}
-
-	for (size_t t = 16; t < 80; t++)
-	{
-		W [t] = DoCircularShift (1, W [t-3] ^ W [t-8] ^ W [t-14] ^ W [t-16]);
-	}
-
-	// Word buffers
-	size_t A = m_digest [0];
-	size_t B = m_digest [1];
-	size_t C = m_digest [2];
-	size_t D = m_digest [3];
-	size_t E = m_digest [4];
-
-	size_t temp = 0;
-	for (size_t t = 0; t < 20; t++)
-	{
-		temp = DoCircularShift (5, A) + ((B & C) | ((~B) & D)) + E + W [t] + K [0];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = DoCircularShift (30, B);
-		B = A;
-		A = temp;
-	}
-
-	for (size_t t = 20; t < 40; t++)
-	{
-		temp = DoCircularShift (5, A) + (B ^ C ^ D) + E + W [t] + K [1];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = DoCircularShift (30, B);
-		B = A;
-		A = temp;
-	}
-
-	for (size_t t = 40; t < 60; t++)
-	{
-		temp = DoCircularShift (5, A) + ((B & C) | (B & D) | (C & D)) + E + W [t] + K [2];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = DoCircularShift (30, B);
-		B = A;
-		A = temp;
-	}
-
-	for (size_t t = 60; t < 80; t++)
-	{
-		temp = DoCircularShift (5, A) + (B ^ C ^ D) + E + W [t] + K [3];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = DoCircularShift (30, B);
-		B = A;
-		A = temp;
-	}
-
-	m_digest [0] = (m_digest [0] + A) & 0xFFFFFFFF;
-	m_digest [1] = (m_digest [1] + B) & 0xFFFFFFFF;
-	m_digest [2] = (m_digest [2] + C) & 0xFFFFFFFF;
-	m_digest [3] = (m_digest [3] + D) & 0xFFFFFFFF;
-	m_digest [4] = (m_digest [4] + E) & 0xFFFFFFFF;
-
-	m_lMessageBlock = 0;
-}
-
 void Sha1::PadMessage () noexcept
 {
+	auto process = GetSha1BlockFunc (m_kernel);
+	uint64_t bits = m_lLength * 8;
+
 	/*
 	*	Check to see if the current message block is too small to hold
 	*	the initial padding bits and length.  If so, we will pad the
 	*	block, process it, and then continue padding into a second block.
 	*/
-	if (m_lMessageBlock > 55)
-	{
-		m_pMessageBlock [m_lMessageBlock++] = 0x80;
-		while (m_lMessageBlock < 64)
-		{
-			m_pMessageBlock [m_lMessageBlock++] = 0;
-		}
-
-		ProcessMessageBlock ();
-
-		while (m_lMessageBlock < 56)
-		{
-			m_pMessageBlock [m_lMessageBlock++] = 0;
-		}
-	}
-	else
+	m_pMessageBlock [m_lMessageBlock++] = 0x80;
+	if (m_lMessageBlock > 56)
 	{
-		m_pMessageBlock [m_lMessageBlock++] = 0x80;
-		while (m_lMessageBlock < 56)
-		{
-			m_pMessageBlock [m_lMessageBlock++] = 0;
-		}
-
+		std::memset (m_pMessageBlock + m_lMessageBlock, 0, 64 - m_lMessageBlock);
+		process (m_digest, m_pMessageBlock, 1);
+		m_lMessageBlock = 0;
 	}
+	std::memset (m_pMessageBlock + m_lMessageBlock, 0, 56 - m_lMessageBlock);
 
 	/*
 	*	Store the message length as the last 8 octets
 	*/
-	m_pMessageBlock [56] = static_cast <unsigned char> ((m_lBitsHigh >> 24) & 0xFF);
-	m_pMessageBlock [57] = static_cast <unsigned char> ((m_lBitsHigh >> 16) & 0xFF);
-	m_pMessageBlock [58] = static_cast <unsigned char> ((m_lBitsHigh >> 8) & 0xFF);
-	m_pMessageBlock [59] = static_cast <unsigned char> ((m_lBitsHigh) & 0xFF);
-	m_pMessageBlock [60] = static_cast <unsigned char> ((m_lBitsLow >> 24) & 0xFF);
-	m_pMessageBlock [61] = static_cast <unsigned char> ((m_lBitsLow >> 16) & 0xFF);
-	m_pMessageBlock [62] = static_cast <unsigned char> ((m_lBitsLow >> 8) & 0xFF);
-	m_pMessageBlock [63] = static_cast <unsigned char> ((m_lBitsLow) & 0xFF);
-
-	ProcessMessageBlock ();
+	for (size_t i = 0; i < 8; i++)
+		m_pMessageBlock [56 + i] = static_cast <unsigned char> (bits >> (56 - i * 8));
+
+	process (m_digest, m_pMessageBlock, 1);
+	m_lMessageBlock = 0;
 }
@@ -1,41 +1,38 @@
-
 #pragma once
+#include "hasher.h"
+#include "sha1kernels.h"
 
-class Sha1
+class Sha1 : public Hasher
 {
 public:
 	Sha1 ();
 
-	void ComputeHash (const unsigned char * data, uintmax_t size) noexcept;
+	void Update (const unsigned char * data, uintmax_t size) noexcept override;
+	void Finalize () noexcept override;
 
-	size_t GetDigestSize () const noexcept { return m_lDigestSize; }
-	void GetDigest (unsigned char * buffer) const noexcept;
+	size_t GetDigestSize () const noexcept override { return m_lDigestSize; }
+	void GetDigest (unsigned char * buffer) const noexcept override;
 
-	std::string GetReport () const noexcept;
+	// block kernel used by every Sha1 object. The fastest one the CPU supports
+	// is selected at startup, SetKernel fails for unsupported ones
+	static Sha1Kernel GetKernel () noexcept;
+	static bool SetKernel (Sha1Kernel kernel) noexcept;
 
 private:
-	void Update (const unsigned char * data, uintmax_t size) noexcept;
-	void Finalize () noexcept;
 	void Reset () noexcept;
 
-	void ProcessMessageBlock () noexcept;
 	void PadMessage () noexcept;
-	char HexDigit (unsigned char b) const noexcept;
-
-	inline size_t DoCircularShift (int bits, size_t word) const noexcept
-	{
-		return ((word << bits) & 0xFFFFFFFF) | ((word & 0xFFFFFFFF) >> (32-bits));
-	}
 
 private:
+	static std::atomic <Sha1Kernel> m_kernel;
+
 	bool m_bIsFinal = false;
 	const size_t m_lDigestSize = 20;
 
-	unsigned int m_digest[5] = {};			// Message digest buffers
+	uint32_t m_digest[5] = {};				// Message digest buffers
 
-	size_t m_lBitsLow = 0;					// Message length in bits
-	size_t m_lBitsHigh = 0;					// Message length in bits
+	uint64_t m_lLength = 0;					// Message length in bytes
 
-	unsigned char m_pMessageBlock[64] = {};	// 512-bit message blocks
-	int m_lMessageBlock = 0;				// Index into message block array
+	unsigned char m_pMessageBlock[64] = {};	// Partial 512-bit message block
+	size_t m_lMessageBlock = 0;				// Bytes in the partial block
 };
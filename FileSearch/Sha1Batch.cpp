@@ -0,0 +1,181 @@
+
+#include "pch.h"
+#include "sha1batch.h"
+#include "sha1.h"
+
+std::atomic <Sha1LanesKernel> Sha1Batch::m_kernel { Sha1Batch::SelectKernel () };
+
+static const uint32_t H [5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+Sha1LanesKernel Sha1Batch::SelectKernel () noexcept
+{
+	// SHA extensions hash one message faster than four SSE2 lanes do. Asks
+	// the CPU rather than Sha1, which may not be initialized yet
+	auto kernel = SelectSha1LanesKernel ();
+	if (Sha1Kernel::shani == SelectSha1Kernel () && GetSha1Lanes (kernel) < 8)
+		return Sha1LanesKernel::none;
+	return kernel;
+}
+
+Sha1LanesKernel Sha1Batch::GetKernel () noexcept
+{
+	return m_kernel;
+}
+
+bool Sha1Batch::SetKernel (Sha1LanesKernel kernel) noexcept
+{
+	if (!IsSha1LanesKernelSupported (kernel))
+		return false;
+	m_kernel = kernel;
+	return true;
+}
+
+size_t Sha1Batch::PreferredCount () noexcept
+{
+	return GetSha1Lanes (m_kernel) * 4;
+}
+
+void Sha1Batch::Add (const unsigned char * data, uintmax_t size, unsigned char * digest)
+{
+	m_messages.push_back ({ data, size, digest });
+}
+
+void Sha1Batch::StoreDigest (const uint32_t * state, size_t stride, unsigned char * digest) noexcept
+{
+	for (size_t i = 0; i < 5; i++)
+	{
+		uint32_t word = state [i * stride];
+		digest [i * 4] = static_cast <unsigned char> (word >> 24);
+		digest [i * 4 + 1] = static_cast <unsigned char> (word >> 16);
+		digest [i * 4 + 2] = static_cast <unsigned char> (word >> 8);
+		digest [i * 4 + 3] = static_cast <unsigned char> (word);
+	}
+}
+
+void Sha1Batch::Run () noexcept
+{
+	Sha1LanesKernel kernel = m_kernel;
+	auto lanes_func = GetSha1LanesFunc (kernel);
+	size_t lanes = GetSha1Lanes (kernel);
+
+	if (nullptr == lanes_func || m_messages.size () < 2)
+	{
+		for (auto & message : m_messages)
+		{
+			Sha1 sha1;
+			sha1.ComputeHash (message.data, message.size);
+			sha1.GetDigest (message.digest);
+		}
+		m_messages.clear ();
+		return;
+	}
+
+	auto block_func = GetSha1BlockFunc (Sha1::GetKernel ());
+
+	// below that many busy lanes the rest is cheaper to finish one by one
+	size_t min_active = lanes / (Sha1Kernel::shani == Sha1::GetKernel () ? 2 : 4);
+
+	alignas (64) uint32_t state [5 * 16] = {};
+	Lane lane [16];
+	static const unsigned char idle [64] = {};
+	size_t next = 0;
+	size_t active = 0;
+
+	auto SwitchToTail = [](Lane & l)
+	{
+		size_t rest = static_cast <size_t> (l.message->size % 64);
+		uint64_t bits = static_cast <uint64_t> (l.message->size) * 8;
+		size_t blocks = (rest < 56 ? 1 : 2);
+
+		std::memcpy (l.tail, l.data, rest);
+		l.tail [rest] = 0x80;
+		std::memset (l.tail + rest + 1, 0, blocks * 64 - 8 - rest - 1);
+		for (size_t i = 0; i < 8; i++)
+			l.tail [blocks * 64 - 8 + i] = static_cast <unsigned char> (bits >> (56 - i * 8));
+
+		l.data = l.tail;
+		l.blocks = blocks;
+		l.in_tail = true;
+	};
+
+	auto Start = [&](size_t n)
+	{
+		Lane & l = lane [n];
+		if (next == m_messages.size ())
+		{
+			l.message = nullptr;
+			return false;
+		}
+
+		l.message = &m_messages [next++];
+		l.data = l.message->data;
+		l.blocks = l.message->size / 64;
+		l.in_tail = false;
+		if (0 == l.blocks)
+			SwitchToTail (l);
+
+		for (size_t i = 0; i < 5; i++)
+			state [i * lanes + n] = H [i];
+		return true;
+	};
+
+	for (size_t n = 0; n < lanes; n++)
+	{
+		if (Start (n))
+			active++;
+	}
+
+	while (active > 0 && active >= min_active)
+	{
+		const unsigned char * blocks [16];
+		for (size_t n = 0; n < lanes; n++)
+			blocks [n] = (nullptr == lane [n].message ? idle : lane [n].data);
+
+		lanes_func (state, blocks);
+
+		for (size_t n = 0; n < lanes; n++)
+		{
+			Lane & l = lane [n];
+			if (nullptr == l.message)
+				continue;
+
+			l.data += 64;
+			if (--l.blocks > 0)
+				continue;
+
+			if (!l.in_tail)
+			{
+				SwitchToTail (l);
+				continue;
+			}
+
+			StoreDigest (state + n, lanes, l.message->digest);
+			if (!Start (n))
+				active--;
+		}
+	}
+
+	// the few messages left go one by one, from where their lanes stopped
+	for (size_t n = 0; n < lanes; n++)
+	{
+		Lane & l = lane [n];
+		if (nullptr == l.message)
+			continue;
+
+		uint32_t words [5];
+		for (size_t i = 0; i < 5; i++)
+			words [i] = state [i * lanes + n];
+
+		block_func (words, l.data, static_cast <size_t> (l.blocks));
+		if (!l.in_tail)
+		{
+			l.data += l.blocks * 64;
+			SwitchToTail (l);
+			block_func (words, l.data, static_cast <size_t> (l.blocks));
+		}
+
+		StoreDigest (words, 1, l.message->digest);
+	}
+
+	m_messages.clear ();
+}
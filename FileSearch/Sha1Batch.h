@@ -0,0 +1,55 @@
+
+#pragma once
+#include "sha1kernels.h"
+
+// Hashes many independent messages at once with a multi-buffer kernel: each
+// SIMD lane takes a message, and a lane whose message is done takes the next
+// one right away. Lots of small files hash several times faster this way.
+// Once too few messages are left to keep the lanes busy, they are finished
+// one by one with the single message kernel of Sha1
+class Sha1Batch
+{
+public:
+	static const size_t m_lDigestSize = 20;
+
+	// data must stay valid until Run, which writes m_lDigestSize bytes to digest
+	void Add (const unsigned char * data, uintmax_t size, unsigned char * digest);
+	size_t Count () const noexcept { return m_messages.size (); }
+	void Run () noexcept;
+
+	// lanes kernel used by every batch. The widest one the CPU supports is
+	// selected at startup, none when hashing one message at a time is as
+	// fast. SetKernel fails for unsupported ones
+	static Sha1LanesKernel GetKernel () noexcept;
+	static bool SetKernel (Sha1LanesKernel kernel) noexcept;
+
+	// number of messages a batch should get to keep the lanes busy
+	static size_t PreferredCount () noexcept;
+
+private:
+	struct Message
+	{
+		const unsigned char * data;
+		uintmax_t size;
+		unsigned char * digest;
+	};
+
+	// message in a lane: whole blocks are taken from the message itself,
+	// the last one or two are padded in tail
+	struct Lane
+	{
+		Message * message = nullptr;
+		const unsigned char * data = nullptr;
+		uintmax_t blocks = 0;
+		bool in_tail = false;
+		unsigned char tail [128] = {};
+	};
+
+	static Sha1LanesKernel SelectKernel () noexcept;
+	static void StoreDigest (const uint32_t * state, size_t stride, unsigned char * digest) noexcept;
+
+private:
+	static std::atomic <Sha1LanesKernel> m_kernel;
+
+	std::vector <Message> m_messages;
+};
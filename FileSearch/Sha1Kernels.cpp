@@ -0,0 +1,636 @@
+
+#include "pch.h"
+#include "sha1kernels.h"
+#include "cpufeatures.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+#define SHA1_X86
+#endif
+
+// GCC and clang need the instruction set of every function using intrinsics,
+// MSVC allows them anywhere. Multi-buffer kernels are flattened: their shared
+// template code is inlined and so compiled for the instruction set of each
+#if defined (__GNUC__) || defined (__clang__)
+#define SHA1_TARGET(isa) __attribute__ ((target (isa)))
+#define SHA1_LANES_TARGET(isa) __attribute__ ((target (isa), flatten))
+#else
+#define SHA1_TARGET(isa)
+#define SHA1_LANES_TARGET(isa)
+#endif
+
+static const uint32_t K [4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+static inline uint32_t Rol (uint32_t x, int bits) noexcept
+{
+	return (x << bits) | (x >> (32 - bits));
+}
+
+// One round. The five working variables are not shifted along: the caller
+// passes them in rotated order instead, five rounds make a full turn
+template <class F>
+static inline void Sha1Round (uint32_t a, uint32_t & b, uint32_t c, uint32_t d, uint32_t & e, uint32_t wk, F f) noexcept
+{
+	e += Rol (a, 5) + f (b, c, d) + wk;
+	b = Rol (b, 30);
+}
+
+// 80 rounds over the message schedule with the round constants already added
+static inline void Sha1Rounds (uint32_t state [5], const uint32_t wk [80]) noexcept
+{
+	uint32_t a = state [0];
+	uint32_t b = state [1];
+	uint32_t c = state [2];
+	uint32_t d = state [3];
+	uint32_t e = state [4];
+
+	auto Rounds = [&](size_t from, auto f)
+	{
+		for (size_t t = from; t < from + 20; t += 5)
+		{
+			Sha1Round (a, b, c, d, e, wk [t], f);
+			Sha1Round (e, a, b, c, d, wk [t + 1], f);
+			Sha1Round (d, e, a, b, c, wk [t + 2], f);
+			Sha1Round (c, d, e, a, b, wk [t + 3], f);
+			Sha1Round (b, c, d, e, a, wk [t + 4], f);
+		}
+	};
+
+	Rounds (0, [](uint32_t b, uint32_t c, uint32_t d) { return d ^ (b & (c ^ d)); });
+	Rounds (20, [](uint32_t b, uint32_t c, uint32_t d) { return b ^ c ^ d; });
+	Rounds (40, [](uint32_t b, uint32_t c, uint32_t d) { return (b & c) | (d & (b | c)); });
+	Rounds (60, [](uint32_t b, uint32_t c, uint32_t d) { return b ^ c ^ d; });
+
+	state [0] += a;
+	state [1] += b;
+	state [2] += c;
+	state [3] += d;
+	state [4] += e;
+}
+
+static void Sha1Blocks_Scalar (uint32_t state [5], const unsigned char * data, size_t blocks)
+{
+	uint32_t w [80];
+	for (; blocks > 0; blocks--, data += 64)
+	{
+		for (size_t t = 0; t < 16; t++)
+		{
+			const unsigned char * p = data + t * 4;
+			w [t] = (uint32_t (p [0]) << 24) | (uint32_t (p [1]) << 16) | (uint32_t (p [2]) << 8) | uint32_t (p [3]);
+		}
+		for (size_t t = 16; t < 80; t++)
+			w [t] = Rol (w [t - 3] ^ w [t - 8] ^ w [t - 14] ^ w [t - 16], 1);
+		for (size_t t = 0; t < 80; t++)
+			w [t] += K [t / 20];
+
+		Sha1Rounds (state, w);
+	}
+}
+
+#ifdef SHA1_X86
+
+// The schedule is computed four words at a time:
+// W[t..t+3] = rol1 (W[t-16..t-13] ^ W[t-14..t-11] ^ W[t-8..t-5] ^ W[t-3..t]),
+// where W[t] of the last term is not known yet. It is taken as 0 and its
+// share, rol1 (W[t]), is xor-ed into the last lane afterwards
+
+SHA1_TARGET ("ssse3")
+static void Sha1Schedule_Ssse3 (const unsigned char * data, uint32_t wk [80])
+{
+	const __m128i swap = _mm_set_epi8 (12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+	__m128i w [20];
+	for (size_t g = 0; g < 4; g++)
+		w [g] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + g * 16)), swap);
+
+	for (size_t g = 4; g < 20; g++)
+	{
+		__m128i x = _mm_xor_si128 (w [g - 4], _mm_alignr_epi8 (w [g - 3], w [g - 4], 8));
+		x = _mm_xor_si128 (x, _mm_xor_si128 (w [g - 2], _mm_srli_si128 (w [g - 1], 4)));
+		x = _mm_or_si128 (_mm_slli_epi32 (x, 1), _mm_srli_epi32 (x, 31));
+
+		__m128i fix = _mm_slli_si128 (x, 12);
+		w [g] = _mm_xor_si128 (x, _mm_or_si128 (_mm_slli_epi32 (fix, 1), _mm_srli_epi32 (fix, 31)));
+	}
+
+	for (size_t g = 0; g < 20; g++)
+		_mm_storeu_si128 (reinterpret_cast <__m128i *> (wk + g * 4), _mm_add_epi32 (w [g], _mm_set1_epi32 (K [g / 5])));
+}
+
+SHA1_TARGET ("ssse3")
+static void Sha1Blocks_Ssse3 (uint32_t state [5], const unsigned char * data, size_t blocks)
+{
+	alignas (16) uint32_t wk [80];
+	for (; blocks > 0; blocks--, data += 64)
+	{
+		Sha1Schedule_Ssse3 (data, wk);
+		Sha1Rounds (state, wk);
+	}
+}
+
+// same schedule with one block in each 128-bit lane
+SHA1_TARGET ("avx2")
+static void Sha1Blocks_Avx2 (uint32_t state [5], const unsigned char * data, size_t blocks)
+{
+	const __m256i swap = _mm256_set_epi8 (
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+	alignas (32) uint32_t wk1 [80];
+	alignas (32) uint32_t wk2 [80];
+
+	for (; blocks >= 2; blocks -= 2, data += 128)
+	{
+		__m256i w [20];
+		for (size_t g = 0; g < 4; g++)
+		{
+			__m128i lo = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + g * 16));
+			__m128i hi = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + 64 + g * 16));
+			w [g] = _mm256_shuffle_epi8 (_mm256_inserti128_si256 (_mm256_castsi128_si256 (lo), hi, 1), swap);
+		}
+
+		for (size_t g = 4; g < 20; g++)
+		{
+			__m256i x = _mm256_xor_si256 (w [g - 4], _mm256_alignr_epi8 (w [g - 3], w [g - 4], 8));
+			x = _mm256_xor_si256 (x, _mm256_xor_si256 (w [g - 2], _mm256_srli_si256 (w [g - 1], 4)));
+			x = _mm256_or_si256 (_mm256_slli_epi32 (x, 1), _mm256_srli_epi32 (x, 31));
+
+			__m256i fix = _mm256_slli_si256 (x, 12);
+			w [g] = _mm256_xor_si256 (x, _mm256_or_si256 (_mm256_slli_epi32 (fix, 1), _mm256_srli_epi32 (fix, 31)));
+		}
+
+		for (size_t g = 0; g < 20; g++)
+		{
+			__m256i v = _mm256_add_epi32 (w [g], _mm256_set1_epi32 (K [g / 5]));
+			_mm_store_si128 (reinterpret_cast <__m128i *> (wk1 + g * 4), _mm256_castsi256_si128 (v));
+			_mm_store_si128 (reinterpret_cast <__m128i *> (wk2 + g * 4), _mm256_extracti128_si256 (v, 1));
+		}
+
+		Sha1Rounds (state, wk1);
+		Sha1Rounds (state, wk2);
+	}
+
+	if (blocks > 0)
+		Sha1Blocks_Ssse3 (state, data, blocks);
+}
+
+SHA1_TARGET ("sha,sse4.1")
+static void Sha1Blocks_ShaNi (uint32_t state [5], const unsigned char * data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x (0x0001020304050607ull, 0x08090a0b0c0d0e0full);
+
+	__m128i abcd = _mm_shuffle_epi32 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (state)), 0x1B);
+	__m128i e0 = _mm_set_epi32 (static_cast <int> (state [4]), 0, 0, 0);
+	__m128i e1;
+	__m128i msg [4];
+
+	for (; blocks > 0; blocks--, data += 64)
+	{
+		__m128i abcd_save = abcd;
+		__m128i e0_save = e0;
+
+		// rounds 0-3
+		msg [0] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + 0)), mask);
+		e0 = _mm_add_epi32 (e0, msg [0]);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+
+		// rounds 4-7
+		msg [1] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + 16)), mask);
+		e1 = _mm_sha1nexte_epu32 (e1, msg [1]);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 0);
+		msg [0] = _mm_sha1msg1_epu32 (msg [0], msg [1]);
+
+		// rounds 8-11
+		msg [2] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + 32)), mask);
+		e0 = _mm_sha1nexte_epu32 (e0, msg [2]);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+		msg [1] = _mm_sha1msg1_epu32 (msg [1], msg [2]);
+		msg [0] = _mm_xor_si128 (msg [0], msg [2]);
+
+		// rounds 12-15
+		msg [3] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast <const __m128i *> (data + 48)), mask);
+		e1 = _mm_sha1nexte_epu32 (e1, msg [3]);
+		e0 = abcd;
+		msg [0] = _mm_sha1msg2_epu32 (msg [0], msg [3]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 0);
+		msg [2] = _mm_sha1msg1_epu32 (msg [2], msg [3]);
+		msg [1] = _mm_xor_si128 (msg [1], msg [3]);
+
+		// rounds 16-19
+		e0 = _mm_sha1nexte_epu32 (e0, msg [0]);
+		e1 = abcd;
+		msg [1] = _mm_sha1msg2_epu32 (msg [1], msg [0]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+		msg [3] = _mm_sha1msg1_epu32 (msg [3], msg [0]);
+		msg [2] = _mm_xor_si128 (msg [2], msg [0]);
+
+		// rounds 20-23
+		e1 = _mm_sha1nexte_epu32 (e1, msg [1]);
+		e0 = abcd;
+		msg [2] = _mm_sha1msg2_epu32 (msg [2], msg [1]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		msg [0] = _mm_sha1msg1_epu32 (msg [0], msg [1]);
+		msg [3] = _mm_xor_si128 (msg [3], msg [1]);
+
+		// rounds 24-27
+		e0 = _mm_sha1nexte_epu32 (e0, msg [2]);
+		e1 = abcd;
+		msg [3] = _mm_sha1msg2_epu32 (msg [3], msg [2]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 1);
+		msg [1] = _mm_sha1msg1_epu32 (msg [1], msg [2]);
+		msg [0] = _mm_xor_si128 (msg [0], msg [2]);
+
+		// rounds 28-31
+		e1 = _mm_sha1nexte_epu32 (e1, msg [3]);
+		e0 = abcd;
+		msg [0] = _mm_sha1msg2_epu32 (msg [0], msg [3]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		msg [2] = _mm_sha1msg1_epu32 (msg [2], msg [3]);
+		msg [1] = _mm_xor_si128 (msg [1], msg [3]);
+
+		// rounds 32-35
+		e0 = _mm_sha1nexte_epu32 (e0, msg [0]);
+		e1 = abcd;
+		msg [1] = _mm_sha1msg2_epu32 (msg [1], msg [0]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 1);
+		msg [3] = _mm_sha1msg1_epu32 (msg [3], msg [0]);
+		msg [2] = _mm_xor_si128 (msg [2], msg [0]);
+
+		// rounds 36-39
+		e1 = _mm_sha1nexte_epu32 (e1, msg [1]);
+		e0 = abcd;
+		msg [2] = _mm_sha1msg2_epu32 (msg [2], msg [1]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		msg [0] = _mm_sha1msg1_epu32 (msg [0], msg [1]);
+		msg [3] = _mm_xor_si128 (msg [3], msg [1]);
+
+		// rounds 40-43
+		e0 = _mm_sha1nexte_epu32 (e0, msg [2]);
+		e1 = abcd;
+		msg [3] = _mm_sha1msg2_epu32 (msg [3], msg [2]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		msg [1] = _mm_sha1msg1_epu32 (msg [1], msg [2]);
+		msg [0] = _mm_xor_si128 (msg [0], msg [2]);
+
+		// rounds 44-47
+		e1 = _mm_sha1nexte_epu32 (e1, msg [3]);
+		e0 = abcd;
+		msg [0] = _mm_sha1msg2_epu32 (msg [0], msg [3]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 2);
+		msg [2] = _mm_sha1msg1_epu32 (msg [2], msg [3]);
+		msg [1] = _mm_xor_si128 (msg [1], msg [3]);
+
+		// rounds 48-51
+		e0 = _mm_sha1nexte_epu32 (e0, msg [0]);
+		e1 = abcd;
+		msg [1] = _mm_sha1msg2_epu32 (msg [1], msg [0]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		msg [3] = _mm_sha1msg1_epu32 (msg [3], msg [0]);
+		msg [2] = _mm_xor_si128 (msg [2], msg [0]);
+
+		// rounds 52-55
+		e1 = _mm_sha1nexte_epu32 (e1, msg [1]);
+		e0 = abcd;
+		msg [2] = _mm_sha1msg2_epu32 (msg [2], msg [1]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 2);
+		msg [0] = _mm_sha1msg1_epu32 (msg [0], msg [1]);
+		msg [3] = _mm_xor_si128 (msg [3], msg [1]);
+
+		// rounds 56-59
+		e0 = _mm_sha1nexte_epu32 (e0, msg [2]);
+		e1 = abcd;
+		msg [3] = _mm_sha1msg2_epu32 (msg [3], msg [2]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		msg [1] = _mm_sha1msg1_epu32 (msg [1], msg [2]);
+		msg [0] = _mm_xor_si128 (msg [0], msg [2]);
+
+		// rounds 60-63
+		e1 = _mm_sha1nexte_epu32 (e1, msg [3]);
+		e0 = abcd;
+		msg [0] = _mm_sha1msg2_epu32 (msg [0], msg [3]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		msg [2] = _mm_sha1msg1_epu32 (msg [2], msg [3]);
+		msg [1] = _mm_xor_si128 (msg [1], msg [3]);
+
+		// rounds 64-67
+		e0 = _mm_sha1nexte_epu32 (e0, msg [0]);
+		e1 = abcd;
+		msg [1] = _mm_sha1msg2_epu32 (msg [1], msg [0]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 3);
+		msg [3] = _mm_sha1msg1_epu32 (msg [3], msg [0]);
+		msg [2] = _mm_xor_si128 (msg [2], msg [0]);
+
+		// rounds 68-71
+		e1 = _mm_sha1nexte_epu32 (e1, msg [1]);
+		e0 = abcd;
+		msg [2] = _mm_sha1msg2_epu32 (msg [2], msg [1]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		msg [3] = _mm_xor_si128 (msg [3], msg [1]);
+
+		// rounds 72-75
+		e0 = _mm_sha1nexte_epu32 (e0, msg [2]);
+		e1 = abcd;
+		msg [3] = _mm_sha1msg2_epu32 (msg [3], msg [2]);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 3);
+
+		// rounds 76-79
+		e1 = _mm_sha1nexte_epu32 (e1, msg [3]);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		e0 = _mm_sha1nexte_epu32 (e0, e0_save);
+		abcd = _mm_add_epi32 (abcd, abcd_save);
+	}
+
+	_mm_storeu_si128 (reinterpret_cast <__m128i *> (state), _mm_shuffle_epi32 (abcd, 0x1B));
+	state [4] = static_cast <uint32_t> (_mm_extract_epi32 (e0, 3));
+}
+
+// Multi-buffer kernels: every vector lane runs the compression of its own
+// message, so the rounds of several messages go in parallel instead of one
+// after another. The traits below give the vector operations of a lane width
+
+struct Sha1Lanes_Sse2
+{
+	using Type = __m128i;
+	static const size_t lanes = 4;
+
+	SHA1_TARGET ("sse2") static Type Load (const uint32_t * p) { return _mm_load_si128 (reinterpret_cast <const __m128i *> (p)); }
+	SHA1_TARGET ("sse2") static void Store (uint32_t * p, Type x) { _mm_store_si128 (reinterpret_cast <__m128i *> (p), x); }
+	SHA1_TARGET ("sse2") static Type Set (uint32_t x) { return _mm_set1_epi32 (static_cast <int> (x)); }
+	SHA1_TARGET ("sse2") static Type Add (Type x, Type y) { return _mm_add_epi32 (x, y); }
+	SHA1_TARGET ("sse2") static Type Xor (Type x, Type y) { return _mm_xor_si128 (x, y); }
+	template <int bits>
+	SHA1_TARGET ("sse2") static Type Rol (Type x) { return _mm_or_si128 (_mm_slli_epi32 (x, bits), _mm_srli_epi32 (x, 32 - bits)); }
+
+	SHA1_TARGET ("sse2") static Type Ch (Type b, Type c, Type d) { return _mm_xor_si128 (d, _mm_and_si128 (b, _mm_xor_si128 (c, d))); }
+	SHA1_TARGET ("sse2") static Type Parity (Type b, Type c, Type d) { return _mm_xor_si128 (_mm_xor_si128 (b, c), d); }
+	SHA1_TARGET ("sse2") static Type Maj (Type b, Type c, Type d) { return _mm_or_si128 (_mm_and_si128 (b, c), _mm_and_si128 (d, _mm_or_si128 (b, c))); }
+};
+
+struct Sha1Lanes_Avx2
+{
+	using Type = __m256i;
+	static const size_t lanes = 8;
+
+	SHA1_TARGET ("avx2") static Type Load (const uint32_t * p) { return _mm256_load_si256 (reinterpret_cast <const __m256i *> (p)); }
+	SHA1_TARGET ("avx2") static void Store (uint32_t * p, Type x) { _mm256_store_si256 (reinterpret_cast <__m256i *> (p), x); }
+	SHA1_TARGET ("avx2") static Type Set (uint32_t x) { return _mm256_set1_epi32 (static_cast <int> (x)); }
+	SHA1_TARGET ("avx2") static Type Add (Type x, Type y) { return _mm256_add_epi32 (x, y); }
+	SHA1_TARGET ("avx2") static Type Xor (Type x, Type y) { return _mm256_xor_si256 (x, y); }
+	template <int bits>
+	SHA1_TARGET ("avx2") static Type Rol (Type x) { return _mm256_or_si256 (_mm256_slli_epi32 (x, bits), _mm256_srli_epi32 (x, 32 - bits)); }
+
+	SHA1_TARGET ("avx2") static Type Ch (Type b, Type c, Type d) { return _mm256_xor_si256 (d, _mm256_and_si256 (b, _mm256_xor_si256 (c, d))); }
+	SHA1_TARGET ("avx2") static Type Parity (Type b, Type c, Type d) { return _mm256_xor_si256 (_mm256_xor_si256 (b, c), d); }
+	SHA1_TARGET ("avx2") static Type Maj (Type b, Type c, Type d) { return _mm256_or_si256 (_mm256_and_si256 (b, c), _mm256_and_si256 (d, _mm256_or_si256 (b, c))); }
+};
+
+// AVX-512 rotates in one instruction and does every round function in one
+// ternary logic instruction
+struct Sha1Lanes_Avx512
+{
+	using Type = __m512i;
+	static const size_t lanes = 16;
+
+	SHA1_TARGET ("avx512f") static Type Load (const uint32_t * p) { return _mm512_load_si512 (p); }
+	SHA1_TARGET ("avx512f") static void Store (uint32_t * p, Type x) { _mm512_store_si512 (p, x); }
+	SHA1_TARGET ("avx512f") static Type Set (uint32_t x) { return _mm512_set1_epi32 (static_cast <int> (x)); }
+	SHA1_TARGET ("avx512f") static Type Add (Type x, Type y) { return _mm512_add_epi32 (x, y); }
+	SHA1_TARGET ("avx512f") static Type Xor (Type x, Type y) { return _mm512_xor_si512 (x, y); }
+	template <int bits>
+	SHA1_TARGET ("avx512f") static Type Rol (Type x) { return _mm512_rol_epi32 (x, bits); }
+
+	SHA1_TARGET ("avx512f") static Type Ch (Type b, Type c, Type d) { return _mm512_ternarylogic_epi32 (b, c, d, 0xCA); }
+	SHA1_TARGET ("avx512f") static Type Parity (Type b, Type c, Type d) { return _mm512_ternarylogic_epi32 (b, c, d, 0x96); }
+	SHA1_TARGET ("avx512f") static Type Maj (Type b, Type c, Type d) { return _mm512_ternarylogic_epi32 (b, c, d, 0xE8); }
+};
+
+// One block of every lane. The schedule is kept as a ring of 16 words, word
+// t is computed right before round t needs it
+template <class V>
+static inline void Sha1LanesBlock (uint32_t * state, const unsigned char * const * blocks) noexcept
+{
+	using T = typename V::Type;
+	const size_t lanes = V::lanes;
+
+	// word t of lane n goes to [t * lanes + n], so a word of all lanes is one load
+	alignas (64) uint32_t words [16 * V::lanes];
+	for (size_t n = 0; n < lanes; n++)
+	{
+		const unsigned char * p = blocks [n];
+		for (size_t t = 0; t < 16; t++, p += 4)
+			words [t * lanes + n] = (uint32_t (p [0]) << 24) | (uint32_t (p [1]) << 16) | (uint32_t (p [2]) << 8) | uint32_t (p [3]);
+	}
+
+	T w [16];
+	for (size_t t = 0; t < 16; t++)
+		w [t] = V::Load (words + t * lanes);
+
+	T a = V::Load (state);
+	T b = V::Load (state + lanes);
+	T c = V::Load (state + lanes * 2);
+	T d = V::Load (state + lanes * 3);
+	T e = V::Load (state + lanes * 4);
+
+	auto Round = [&w](size_t t, T a, T & b, T c, T d, T & e, T k, auto f)
+	{
+		if (t >= 16)
+			w [t & 15] = V::template Rol <1> (V::Xor (V::Xor (w [(t - 3) & 15], w [(t - 8) & 15]), V::Xor (w [(t - 14) & 15], w [t & 15])));
+		e = V::Add (V::Add (e, V::template Rol <5> (a)), V::Add (f (b, c, d), V::Add (w [t & 15], k)));
+		b = V::template Rol <30> (b);
+	};
+
+	auto Rounds = [&](size_t from, auto f)
+	{
+		T k = V::Set (K [from / 20]);
+		for (size_t t = from; t < from + 20; t += 5)
+		{
+			Round (t, a, b, c, d, e, k, f);
+			Round (t + 1, e, a, b, c, d, k, f);
+			Round (t + 2, d, e, a, b, c, k, f);
+			Round (t + 3, c, d, e, a, b, k, f);
+			Round (t + 4, b, c, d, e, a, k, f);
+		}
+	};
+
+	Rounds (0, V::Ch);
+	Rounds (20, V::Parity);
+	Rounds (40, V::Maj);
+	Rounds (60, V::Parity);
+
+	V::Store (state, V::Add (a, V::Load (state)));
+	V::Store (state + lanes, V::Add (b, V::Load (state + lanes)));
+	V::Store (state + lanes * 2, V::Add (c, V::Load (state + lanes * 2)));
+	V::Store (state + lanes * 3, V::Add (d, V::Load (state + lanes * 3)));
+	V::Store (state + lanes * 4, V::Add (e, V::Load (state + lanes * 4)));
+}
+
+// the whole block is inlined into each kernel, compiled for its instruction set
+SHA1_LANES_TARGET ("sse2")
+static void Sha1Lanes_Sse2Block (uint32_t * state, const unsigned char * const * blocks)
+{
+	Sha1LanesBlock <Sha1Lanes_Sse2> (state, blocks);
+}
+
+SHA1_LANES_TARGET ("avx2")
+static void Sha1Lanes_Avx2Block (uint32_t * state, const unsigned char * const * blocks)
+{
+	Sha1LanesBlock <Sha1Lanes_Avx2> (state, blocks);
+}
+
+SHA1_LANES_TARGET ("avx512f")
+static void Sha1Lanes_Avx512Block (uint32_t * state, const unsigned char * const * blocks)
+{
+	Sha1LanesBlock <Sha1Lanes_Avx512> (state, blocks);
+}
+
+#endif // SHA1_X86
+
+bool IsSha1KernelSupported (Sha1Kernel kernel) noexcept
+{
+	if (Sha1Kernel::scalar == kernel)
+		return true;
+
+#ifdef SHA1_X86
+	auto & cpu = GetCpuFeatures ();
+
+	switch (kernel)
+	{
+	case Sha1Kernel::ssse3:
+		return cpu.ssse3;
+	case Sha1Kernel::avx2:
+		return cpu.ssse3 && cpu.avx2;
+	case Sha1Kernel::shani:
+		return cpu.ssse3 && cpu.sse41 && cpu.sha;
+	default:
+		break;
+	}
+#endif
+
+	return false;
+}
+
+Sha1BlockFunc GetSha1BlockFunc (Sha1Kernel kernel) noexcept
+{
+	switch (kernel)
+	{
+#ifdef SHA1_X86
+	case Sha1Kernel::ssse3:
+		return Sha1Blocks_Ssse3;
+	case Sha1Kernel::avx2:
+		return Sha1Blocks_Avx2;
+	case Sha1Kernel::shani:
+		return Sha1Blocks_ShaNi;
+#endif
+	default:
+		return Sha1Blocks_Scalar;
+	}
+}
+
+const char * GetSha1KernelName (Sha1Kernel kernel) noexcept
+{
+	switch (kernel)
+	{
+	case Sha1Kernel::ssse3:
+		return "ssse3";
+	case Sha1Kernel::avx2:
+		return "avx2";
+	case Sha1Kernel::shani:
+		return "sha-ni";
+	default:
+		return "scalar";
+	}
+}
+
+Sha1Kernel SelectSha1Kernel () noexcept
+{
+	for (auto kernel : { Sha1Kernel::shani, Sha1Kernel::avx2, Sha1Kernel::ssse3 })
+	{
+		if (IsSha1KernelSupported (kernel))
+			return kernel;
+	}
+	return Sha1Kernel::scalar;
+}
+
+bool IsSha1LanesKernelSupported (Sha1LanesKernel kernel) noexcept
+{
+	if (Sha1LanesKernel::none == kernel)
+		return true;
+
+#ifdef SHA1_X86
+	auto & cpu = GetCpuFeatures ();
+
+	switch (kernel)
+	{
+	case Sha1LanesKernel::sse2:
+		return cpu.sse2;
+	case Sha1LanesKernel::avx2:
+		return cpu.avx2;
+	case Sha1LanesKernel::avx512:
+		return cpu.avx512f;
+	default:
+		break;
+	}
+#endif
+
+	return false;
+}
+
+Sha1LanesFunc GetSha1LanesFunc (Sha1LanesKernel kernel) noexcept
+{
+	switch (kernel)
+	{
+#ifdef SHA1_X86
+	case Sha1LanesKernel::sse2:
+		return Sha1Lanes_Sse2Block;
+	case Sha1LanesKernel::avx2:
+		return Sha1Lanes_Avx2Block;
+	case Sha1LanesKernel::avx512:
+		return Sha1Lanes_Avx512Block;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+size_t GetSha1Lanes (Sha1LanesKernel kernel) noexcept
+{
+	switch (kernel)
+	{
+	case Sha1LanesKernel::sse2:
+		return 4;
+	case Sha1LanesKernel::avx2:
+		return 8;
+	case Sha1LanesKernel::avx512:
+		return 16;
+	default:
+		return 1;
+	}
+}
+
+const char * GetSha1LanesKernelName (Sha1LanesKernel kernel) noexcept
+{
+	switch (kernel)
+	{
+	case Sha1LanesKernel::sse2:
+		return "sse2 x4";
+	case Sha1LanesKernel::avx2:
+		return "avx2 x8";
+	case Sha1LanesKernel::avx512:
+		return "avx512 x16";
+	default:
+		return "none";
+	}
+}
+
+Sha1LanesKernel SelectSha1LanesKernel () noexcept
+{
+	for (auto kernel : { Sha1LanesKernel::avx512, Sha1LanesKernel::avx2, Sha1LanesKernel::sse2 })
+	{
+		if (IsSha1LanesKernelSupported (kernel))
+			return kernel;
+	}
+	return Sha1LanesKernel::none;
+}
@@ -0,0 +1,39 @@
+
+#pragma once
+
+// SHA-1 compression over whole 64-byte blocks, taken straight from the input.
+// All kernels give identical results and differ only in the instructions
+// they use. Sha1 picks the fastest one the CPU supports once, at startup
+enum class Sha1Kernel
+{
+	scalar,		// plain C++
+	ssse3,		// SSSE3 message schedule, scalar rounds
+	avx2,		// message schedule of two blocks at once, scalar rounds
+	shani		// SHA extensions do the whole compression
+};
+
+using Sha1BlockFunc = void (*) (uint32_t state [5], const unsigned char * data, size_t blocks);
+
+bool IsSha1KernelSupported (Sha1Kernel kernel) noexcept;
+Sha1BlockFunc GetSha1BlockFunc (Sha1Kernel kernel) noexcept;
+const char * GetSha1KernelName (Sha1Kernel kernel) noexcept;
+Sha1Kernel SelectSha1Kernel () noexcept;
+
+// Multi-buffer SHA-1: one block of each of several independent messages per
+// call, every message in its own SIMD lane. Word i of the state of lane n is
+// at state [i * lanes + n], the state is aligned to 64 bytes
+enum class Sha1LanesKernel
+{
+	none,		// no lanes, messages are hashed one by one
+	sse2,		// 4 lanes
+	avx2,		// 8 lanes
+	avx512		// 16 lanes
+};
+
+using Sha1LanesFunc = void (*) (uint32_t * state, const unsigned char * const * blocks);
+
+bool IsSha1LanesKernelSupported (Sha1LanesKernel kernel) noexcept;
+Sha1LanesFunc GetSha1LanesFunc (Sha1LanesKernel kernel) noexcept;
+size_t GetSha1Lanes (Sha1LanesKernel kernel) noexcept;
+const char * GetSha1LanesKernelName (Sha1LanesKernel kernel) noexcept;
+Sha1LanesKernel SelectSha1LanesKernel () noexcept;
@@ -0,0 +1,147 @@
+
+#include "pch.h"
+#include "sha256.h"
+
+static const uint32_t K [64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t Ror (uint32_t x, int bits) noexcept
+{
+	return (x >> bits) | (x << (32 - bits));
+}
+
+Sha256::Sha256 ()
+{
+	static const uint32_t H [8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	std::memcpy (m_digest, H, sizeof (m_digest));
+}
+
+void Sha256::ProcessBlocks (const unsigned char * data, size_t blocks) noexcept
+{
+	uint32_t w [64];
+	for (; blocks > 0; blocks--, data += 64)
+	{
+		for (size_t t = 0; t < 16; t++)
+		{
+			const unsigned char * p = data + t * 4;
+			w [t] = (uint32_t (p [0]) << 24) | (uint32_t (p [1]) << 16) | (uint32_t (p [2]) << 8) | uint32_t (p [3]);
+		}
+		for (size_t t = 16; t < 64; t++)
+		{
+			uint32_t s0 = Ror (w [t - 15], 7) ^ Ror (w [t - 15], 18) ^ (w [t - 15] >> 3);
+			uint32_t s1 = Ror (w [t - 2], 17) ^ Ror (w [t - 2], 19) ^ (w [t - 2] >> 10);
+			w [t] = w [t - 16] + s0 + w [t - 7] + s1;
+		}
+
+		uint32_t a = m_digest [0], b = m_digest [1], c = m_digest [2], d = m_digest [3];
+		uint32_t e = m_digest [4], f = m_digest [5], g = m_digest [6], h = m_digest [7];
+
+		for (size_t t = 0; t < 64; t++)
+		{
+			uint32_t t1 = h + (Ror (e, 6) ^ Ror (e, 11) ^ Ror (e, 25)) + (g ^ (e & (f ^ g))) + K [t] + w [t];
+			uint32_t t2 = (Ror (a, 2) ^ Ror (a, 13) ^ Ror (a, 22)) + ((a & b) | (c & (a | b)));
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		m_digest [0] += a;
+		m_digest [1] += b;
+		m_digest [2] += c;
+		m_digest [3] += d;
+		m_digest [4] += e;
+		m_digest [5] += f;
+		m_digest [6] += g;
+		m_digest [7] += h;
+	}
+}
+
+void Sha256::Update (const unsigned char * data, uintmax_t size) noexcept
+{
+	if (nullptr == data || m_bIsFinal)
+		return;
+
+	m_lLength += size;
+
+	// complete a block left from the previous call first
+	if (m_lMessageBlock > 0)
+	{
+		size_t part = static_cast <size_t> (std::min <uintmax_t> (64 - m_lMessageBlock, size));
+		std::memcpy (m_pMessageBlock + m_lMessageBlock, data, part);
+		m_lMessageBlock += part;
+		data += part;
+		size -= part;
+
+		if (m_lMessageBlock < 64)
+			return;
+
+		ProcessBlocks (m_pMessageBlock, 1);
+		m_lMessageBlock = 0;
+	}
+
+	// whole blocks straight from the input
+	uintmax_t blocks = size / 64;
+	if (blocks > 0)
+	{
+		ProcessBlocks (data, static_cast <size_t> (blocks));
+		data += blocks * 64;
+		size -= blocks * 64;
+	}
+
+	std::memcpy (m_pMessageBlock, data, static_cast <size_t> (size));
+	m_lMessageBlock = static_cast <size_t> (size);
+}
+
+void Sha256::Finalize () noexcept
+{
+	if (m_bIsFinal)
+		return;
+
+	uint64_t bits = m_lLength * 8;
+
+	// the 0x80 marker, zeroes and the bit length, in a second block if the
+	// length does not fit into this one
+	m_pMessageBlock [m_lMessageBlock++] = 0x80;
+	if (m_lMessageBlock > 56)
+	{
+		std::memset (m_pMessageBlock + m_lMessageBlock, 0, 64 - m_lMessageBlock);
+		ProcessBlocks (m_pMessageBlock, 1);
+		m_lMessageBlock = 0;
+	}
+	std::memset (m_pMessageBlock + m_lMessageBlock, 0, 56 - m_lMessageBlock);
+
+	for (size_t i = 0; i < 8; i++)
+		m_pMessageBlock [56 + i] = static_cast <unsigned char> (bits >> (56 - i * 8));
+
+	ProcessBlocks (m_pMessageBlock, 1);
+	m_lMessageBlock = 0;
+	m_bIsFinal = true;
+}
+
+void Sha256::GetDigest (unsigned char * buffer) const noexcept
+{
+	if (nullptr == buffer || !m_bIsFinal)
+		return;
+
+	for (size_t i = 0; i < m_lDigestSize / 4; i++)
+	{
+		buffer [i * 4] = static_cast <unsigned char> (m_digest [i] >> 24);
+		buffer [i * 4 + 1] = static_cast <unsigned char> (m_digest [i] >> 16);
+		buffer [i * 4 + 2] = static_cast <unsigned char> (m_digest [i] >> 8);
+		buffer [i * 4 + 3] = static_cast <unsigned char> (m_digest [i]);
+	}
+}
@@ -0,0 +1,29 @@
+
+#pragma once
+#include "hasher.h"
+
+class Sha256 : public Hasher
+{
+public:
+	Sha256 ();
+
+	void Update (const unsigned char * data, uintmax_t size) noexcept override;
+	void Finalize () noexcept override;
+
+	size_t GetDigestSize () const noexcept override { return m_lDigestSize; }
+	void GetDigest (unsigned char * buffer) const noexcept override;
+
+private:
+	void ProcessBlocks (const unsigned char * data, size_t blocks) noexcept;
+
+private:
+	bool m_bIsFinal = false;
+	const size_t m_lDigestSize = 32;
+
+	uint32_t m_digest[8] = {};				// Message digest buffers
+
+	uint64_t m_lLength = 0;					// Message length in bytes
+
+	unsigned char m_pMessageBlock[64] = {};	// Partial 512-bit message block
+	size_t m_lMessageBlock = 0;				// Bytes in the partial block
+};
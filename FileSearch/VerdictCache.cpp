@@ -0,0 +1,69 @@
+
+#include "pch.h"
+#include "VerdictCache.h"
+
+uint64_t VerdictCache::Hash (std::wstring_view name, unsigned kind) noexcept
+{
+	uint64_t h = std::hash <std::wstring_view> () (name);
+	return (h ^ kind) * 0x9E3779B97F4A7C15ull;
+}
+
+bool VerdictCache::Same (const Slot & slot, uint64_t hash, std::wstring_view name, unsigned kind) noexcept
+{
+	return slot.used && slot.hash == hash && slot.kind == kind && slot.length == name.size () &&
+		std::wmemcmp (slot.name, name.data (), name.size ()) == 0;
+}
+
+bool VerdictCache::Find (std::wstring_view name, unsigned kind, bool & verdict)
+{
+	if (!m_enabled || name.size () > m_lMaxName)
+		return false;
+
+	uint64_t hash = Hash (name, kind);
+	auto & shard = m_shards [hash % m_lShards];
+
+	std::lock_guard <std::mutex> lk (shard.lock);
+	if (shard.buckets.empty ())
+		return false;
+
+	auto & bucket = shard.buckets [(hash / m_lShards) % m_lBuckets];
+	for (auto & slot : bucket.ways)
+	{
+		if (Same (slot, hash, name, kind))
+		{
+			verdict = slot.verdict;
+			return true;
+		}
+	}
+	return false;
+}
+
+void VerdictCache::Store (std::wstring_view name, unsigned kind, bool verdict)
+{
+	if (!m_enabled || name.size () > m_lMaxName)
+		return;
+
+	uint64_t hash = Hash (name, kind);
+	auto & shard = m_shards [hash % m_lShards];
+
+	std::lock_guard <std::mutex> lk (shard.lock);
+	if (shard.buckets.empty ())
+		shard.buckets.resize (m_lBuckets);
+
+	auto & bucket = shard.buckets [(hash / m_lShards) % m_lBuckets];
+	for (auto & slot : bucket.ways)
+	{
+		if (Same (slot, hash, name, kind))
+			return;
+	}
+
+	auto & slot = bucket.ways [bucket.victim];
+	bucket.victim = (bucket.victim + 1) % m_lWays;
+
+	slot.hash = hash;
+	slot.length = static_cast <uint16_t> (name.size ());
+	slot.kind = static_cast <uint8_t> (kind);
+	slot.verdict = verdict;
+	slot.used = true;
+	std::wmemcpy (slot.name, name.data (), name.size ());
+}
@@ -0,0 +1,57 @@
+
+#pragma once
+
+// Bounded memo of mask verdicts for bare file and directory names, shared by
+// the traversal threads. The table has a fixed number of slots split into
+// shards with a lock of their own, a name hashes to a bucket of a few slots
+// and a full bucket evicts its oldest entry, so memory does not depend on
+// how many entries get scanned. Names are kept inline in the slots, longer
+// names are not cached at all
+class VerdictCache
+{
+public:
+	static const size_t m_lMaxName = 32;
+
+private:
+	static const size_t m_lShards = 32;
+	static const size_t m_lBuckets = 128;		// per shard
+	static const size_t m_lWays = 4;
+
+	struct Slot
+	{
+		uint64_t hash = 0;
+		uint16_t length = 0;
+		uint8_t kind = 0;
+		bool verdict = false;
+		bool used = false;
+		wchar_t name [m_lMaxName];
+	};
+
+	struct Bucket
+	{
+		Slot ways [m_lWays];
+		size_t victim = 0;
+	};
+
+	struct Shard
+	{
+		std::mutex lock;
+		std::vector <Bucket> buckets;			// allocated on first store
+	};
+
+	std::array <Shard, m_lShards> m_shards;
+	bool m_enabled = true;
+
+public:
+	void Enable (bool enable) noexcept
+	{
+		m_enabled = enable;
+	}
+
+	bool Find (std::wstring_view name, unsigned kind, bool & verdict);
+	void Store (std::wstring_view name, unsigned kind, bool verdict);
+
+private:
+	static uint64_t Hash (std::wstring_view name, unsigned kind) noexcept;
+	static bool Same (const Slot & slot, uint64_t hash, std::wstring_view name, unsigned kind) noexcept;
+};
@@ -0,0 +1,145 @@
+
+#pragma once
+
+// Pool of worker threads where every worker owns a deque of pending items.
+// A worker takes items from the back of its own deque (depth first, good for
+// locality) and steals from the front of the other deques when it runs dry.
+// Run () returns once the last item, including ones pushed by the workers
+// themselves, has been processed.
+template <class T>
+class WorkStealingPool
+{
+	struct Worker
+	{
+		std::mutex lock;
+		std::deque <T> items;
+	};
+
+	std::vector <std::unique_ptr <Worker>> m_workers;
+
+	std::atomic <size_t> m_pending { 0 };		// pushed but not processed yet
+	std::atomic <size_t> m_queued { 0 };		// sitting in one of the deques
+	std::atomic <bool> m_abort { false };
+
+	std::mutex m_idle_mutex;
+	std::condition_variable m_idle;
+
+	std::exception_ptr m_error;
+
+public:
+	using Handler = std::function <void (size_t worker, T & item)>;
+
+	WorkStealingPool (size_t threads)
+	{
+		if (0 == threads)
+			threads = 1;
+		for (size_t i = 0; i < threads; i++)
+			m_workers.push_back (std::make_unique <Worker> ());
+	}
+
+	WorkStealingPool (const WorkStealingPool &) = delete;
+	WorkStealingPool & operator = (const WorkStealingPool &) = delete;
+
+	size_t Size () const noexcept
+	{
+		return m_workers.size ();
+	}
+
+	void Push (size_t worker, T && item)
+	{
+		m_pending++;
+		{
+			auto & w = *m_workers [worker % m_workers.size ()];
+			std::lock_guard <std::mutex> lk (w.lock);
+			w.items.push_back (std::move (item));
+		}
+		m_queued++;
+
+		std::lock_guard <std::mutex> lk (m_idle_mutex);
+		m_idle.notify_one ();
+	}
+
+	void Run (std::list <T> && items, Handler handler)
+	{
+		size_t n = 0;
+		for (auto & item : items)
+			Push (n++, std::move (item));
+
+		std::vector <std::thread> threads;
+		for (size_t i = 0; i < m_workers.size (); i++)
+			threads.emplace_back (&WorkStealingPool::WorkerLoop, this, i, std::ref (handler));
+
+		for (auto & t : threads)
+			t.join ();
+
+		if (m_error != nullptr)
+			std::rethrow_exception (m_error);
+	}
+
+private:
+	bool Pop (size_t worker, T & item)
+	{
+		auto & own = *m_workers [worker];
+		{
+			std::lock_guard <std::mutex> lk (own.lock);
+			if (!own.items.empty ())
+			{
+				item = std::move (own.items.back ());
+				own.items.pop_back ();
+				m_queued--;
+				return true;
+			}
+		}
+
+		for (size_t i = 1; i < m_workers.size (); i++)
+		{
+			auto & victim = *m_workers [(worker + i) % m_workers.size ()];
+			std::lock_guard <std::mutex> lk (victim.lock);
+			if (!victim.items.empty ())
+			{
+				item = std::move (victim.items.front ());
+				victim.items.pop_front ();
+				m_queued--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void WorkerLoop (size_t worker, Handler & handler)
+	{
+		while (!m_abort)
+		{
+			T item;
+			if (Pop (worker, item))
+			{
+				try
+				{
+					handler (worker, item);
+				}
+				catch (...)
+				{
+					std::lock_guard <std::mutex> lk (m_idle_mutex);
+					if (nullptr == m_error)
+						m_error = std::current_exception ();
+					m_abort = true;
+					m_idle.notify_all ();
+					return;
+				}
+
+				if (0 == --m_pending)
+				{
+					std::lock_guard <std::mutex> lk (m_idle_mutex);
+					m_idle.notify_all ();
+				}
+				continue;
+			}
+
+			std::unique_lock <std::mutex> lk (m_idle_mutex);
+			m_idle.wait (lk, [this] { return m_abort || m_queued > 0 || 0 == m_pending; });
+			if (0 == m_pending)
+				return;
+		}
+	}
+};
@@ -0,0 +1,402 @@
+
+#include "pch.h"
+#include "xxh3.h"
+
+static const uint64_t PRIME32_1 = 0x9E3779B1U;
+static const uint64_t PRIME32_2 = 0x85EBCA77U;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+static const size_t STRIPE_LEN = 64;
+static const size_t SECRET_CONSUME_RATE = 8;
+static const size_t SECRET_SIZE_MIN = 136;
+static const size_t MIDSIZE_MAX = 240;
+static const size_t STRIPES_PER_BLOCK = (192 - STRIPE_LEN) / SECRET_CONSUME_RATE;
+
+static const unsigned char kSecret [192] =
+{
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+struct Hash128
+{
+	uint64_t lo;
+	uint64_t hi;
+};
+
+static inline uint32_t Read32 (const unsigned char * p) noexcept
+{
+	return uint32_t (p [0]) | (uint32_t (p [1]) << 8) | (uint32_t (p [2]) << 16) | (uint32_t (p [3]) << 24);
+}
+
+static inline uint64_t Read64 (const unsigned char * p) noexcept
+{
+	return uint64_t (Read32 (p)) | (uint64_t (Read32 (p + 4)) << 32);
+}
+
+static inline uint32_t Swap32 (uint32_t x) noexcept
+{
+	return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+static inline uint64_t Swap64 (uint64_t x) noexcept
+{
+	return (uint64_t (Swap32 (static_cast <uint32_t> (x))) << 32) | Swap32 (static_cast <uint32_t> (x >> 32));
+}
+
+static inline uint32_t Rotl32 (uint32_t x, int bits) noexcept
+{
+	return (x << bits) | (x >> (32 - bits));
+}
+
+static inline Hash128 Mult64to128 (uint64_t a, uint64_t b) noexcept
+{
+#if defined (__SIZEOF_INT128__)
+	unsigned __int128 product = static_cast <unsigned __int128> (a) * b;
+	return { static_cast <uint64_t> (product), static_cast <uint64_t> (product >> 64) };
+#elif defined (_M_X64)
+	uint64_t hi = 0;
+	uint64_t lo = _umul128 (a, b, &hi);
+	return { lo, hi };
+#else
+	uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+	uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+	uint64_t hi_hi = (a >> 32) * (b >> 32);
+	uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+	return { (cross << 32) | (lo_lo & 0xFFFFFFFF), (hi_lo >> 32) + (cross >> 32) + hi_hi };
+#endif
+}
+
+static inline uint64_t Mul128Fold64 (uint64_t a, uint64_t b) noexcept
+{
+	Hash128 product = Mult64to128 (a, b);
+	return product.lo ^ product.hi;
+}
+
+static inline uint64_t XorShift64 (uint64_t x, int shift) noexcept
+{
+	return x ^ (x >> shift);
+}
+
+static uint64_t Xxh64Avalanche (uint64_t h) noexcept
+{
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+static uint64_t Avalanche (uint64_t h) noexcept
+{
+	h = XorShift64 (h, 37);
+	h *= PRIME_MX1;
+	h = XorShift64 (h, 32);
+	return h;
+}
+
+static inline uint64_t Mix16B (const unsigned char * input, const unsigned char * secret) noexcept
+{
+	return Mul128Fold64 (Read64 (input) ^ Read64 (secret), Read64 (input + 8) ^ Read64 (secret + 8));
+}
+
+static inline Hash128 Mix32B (Hash128 acc, const unsigned char * input1, const unsigned char * input2, const unsigned char * secret) noexcept
+{
+	acc.lo += Mix16B (input1, secret);
+	acc.lo ^= Read64 (input2) + Read64 (input2 + 8);
+	acc.hi += Mix16B (input2, secret + 16);
+	acc.hi ^= Read64 (input1) + Read64 (input1 + 8);
+	return acc;
+}
+
+// common ending of the 17 to 240 byte cases
+static Hash128 FinalizeMid (Hash128 acc, size_t len) noexcept
+{
+	Hash128 h;
+	h.lo = Avalanche (acc.lo + acc.hi);
+	h.hi = 0 - Avalanche ((acc.lo * PRIME64_1) + (acc.hi * PRIME64_4) + (len * PRIME64_2));
+	return h;
+}
+
+static Hash128 HashShort (const unsigned char * input, size_t len) noexcept
+{
+	const unsigned char * secret = kSecret;
+
+	if (0 == len)
+	{
+		return { Xxh64Avalanche (Read64 (secret + 64) ^ Read64 (secret + 72)),
+			Xxh64Avalanche (Read64 (secret + 80) ^ Read64 (secret + 88)) };
+	}
+
+	if (len <= 3)
+	{
+		uint32_t combined_lo = (uint32_t (input [0]) << 16) | (uint32_t (input [len >> 1]) << 24) | uint32_t (input [len - 1]) | (uint32_t (len) << 8);
+		uint32_t combined_hi = Rotl32 (Swap32 (combined_lo), 13);
+		uint64_t bitflip_lo = Read32 (secret) ^ Read32 (secret + 4);
+		uint64_t bitflip_hi = Read32 (secret + 8) ^ Read32 (secret + 12);
+		return { Xxh64Avalanche (combined_lo ^ bitflip_lo), Xxh64Avalanche (combined_hi ^ bitflip_hi) };
+	}
+
+	if (len <= 8)
+	{
+		uint64_t input64 = Read32 (input) + (uint64_t (Read32 (input + len - 4)) << 32);
+		uint64_t bitflip = Read64 (secret + 16) ^ Read64 (secret + 24);
+		Hash128 m = Mult64to128 (input64 ^ bitflip, PRIME64_1 + (len << 2));
+
+		m.hi += (m.lo << 1);
+		m.lo ^= (m.hi >> 3);
+
+		m.lo = XorShift64 (m.lo, 35);
+		m.lo *= PRIME_MX2;
+		m.lo = XorShift64 (m.lo, 28);
+		m.hi = Avalanche (m.hi);
+		return m;
+	}
+
+	if (len <= 16)
+	{
+		uint64_t bitflip_lo = Read64 (secret + 32) ^ Read64 (secret + 40);
+		uint64_t bitflip_hi = Read64 (secret + 48) ^ Read64 (secret + 56);
+		uint64_t input_lo = Read64 (input);
+		uint64_t input_hi = Read64 (input + len - 8);
+		Hash128 m = Mult64to128 (input_lo ^ input_hi ^ bitflip_lo, PRIME64_1);
+
+		m.lo += uint64_t (len - 1) << 54;
+		input_hi ^= bitflip_hi;
+		m.hi += input_hi + (uint64_t (static_cast <uint32_t> (input_hi)) * (PRIME32_2 - 1));
+		m.lo ^= Swap64 (m.hi);
+
+		Hash128 h = Mult64to128 (m.lo, PRIME64_2);
+		h.hi += m.hi * PRIME64_2;
+		h.lo = Avalanche (h.lo);
+		h.hi = Avalanche (h.hi);
+		return h;
+	}
+
+	Hash128 acc = { len * PRIME64_1, 0 };
+
+	if (len <= 128)
+	{
+		if (len > 32)
+		{
+			if (len > 64)
+			{
+				if (len > 96)
+					acc = Mix32B (acc, input + 48, input + len - 64, secret + 96);
+				acc = Mix32B (acc, input + 32, input + len - 48, secret + 64);
+			}
+			acc = Mix32B (acc, input + 16, input + len - 32, secret + 32);
+		}
+		acc = Mix32B (acc, input, input + len - 16, secret);
+		return FinalizeMid (acc, len);
+	}
+
+	// 129 to 240 bytes
+	for (size_t i = 32; i < 160; i += 32)
+		acc = Mix32B (acc, input + i - 32, input + i - 16, secret + i - 32);
+	acc.lo = Avalanche (acc.lo);
+	acc.hi = Avalanche (acc.hi);
+
+	for (size_t i = 160; i <= len; i += 32)
+		acc = Mix32B (acc, input + i - 32, input + i - 16, secret + 3 + i - 160);
+
+	acc = Mix32B (acc, input + len - 16, input + len - 32, secret + SECRET_SIZE_MIN - 17 - 16);
+	return FinalizeMid (acc, len);
+}
+
+#if defined (_M_X64) || defined (__SSE2__)
+
+// SSE2 is there on every x64 CPU: two lanes per instruction
+static inline void Accumulate512 (uint64_t acc [8], const unsigned char * input, const unsigned char * secret) noexcept
+{
+	for (size_t i = 0; i < 4; i++)
+	{
+		__m128i data_vec = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (input + i * 16));
+		__m128i key_vec = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (secret + i * 16));
+		__m128i data_key = _mm_xor_si128 (data_vec, key_vec);
+		__m128i product = _mm_mul_epu32 (data_key, _mm_shuffle_epi32 (data_key, _MM_SHUFFLE (0, 3, 0, 1)));
+		__m128i data_swap = _mm_shuffle_epi32 (data_vec, _MM_SHUFFLE (1, 0, 3, 2));
+
+		__m128i * a = reinterpret_cast <__m128i *> (acc + i * 2);
+		_mm_storeu_si128 (a, _mm_add_epi64 (product, _mm_add_epi64 (_mm_loadu_si128 (a), data_swap)));
+	}
+}
+
+static inline void ScrambleAcc (uint64_t acc [8], const unsigned char * secret) noexcept
+{
+	const __m128i prime = _mm_set1_epi32 (static_cast <int> (PRIME32_1));
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		__m128i * a = reinterpret_cast <__m128i *> (acc + i * 2);
+		__m128i acc_vec = _mm_loadu_si128 (a);
+		__m128i data_vec = _mm_xor_si128 (acc_vec, _mm_srli_epi64 (acc_vec, 47));
+		__m128i data_key = _mm_xor_si128 (data_vec, _mm_loadu_si128 (reinterpret_cast <const __m128i *> (secret + i * 16)));
+
+		__m128i product_lo = _mm_mul_epu32 (data_key, prime);
+		__m128i product_hi = _mm_mul_epu32 (_mm_shuffle_epi32 (data_key, _MM_SHUFFLE (0, 3, 0, 1)), prime);
+		_mm_storeu_si128 (a, _mm_add_epi64 (product_lo, _mm_slli_epi64 (product_hi, 32)));
+	}
+}
+
+#else
+
+static inline void Accumulate512 (uint64_t acc [8], const unsigned char * input, const unsigned char * secret) noexcept
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		uint64_t data_val = Read64 (input + i * 8);
+		uint64_t data_key = data_val ^ Read64 (secret + i * 8);
+		acc [i ^ 1] += data_val;
+		acc [i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+	}
+}
+
+static inline void ScrambleAcc (uint64_t acc [8], const unsigned char * secret) noexcept
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		uint64_t a = XorShift64 (acc [i], 47);
+		a ^= Read64 (secret + i * 8);
+		acc [i] = a * PRIME32_1;
+	}
+}
+
+#endif
+
+static uint64_t MergeAccs (const uint64_t acc [8], const unsigned char * secret, uint64_t start) noexcept
+{
+	uint64_t result = start;
+	for (size_t i = 0; i < 4; i++)
+		result += Mul128Fold64 (acc [2 * i] ^ Read64 (secret + 16 * i), acc [2 * i + 1] ^ Read64 (secret + 16 * i + 8));
+	return Avalanche (result);
+}
+
+Xxh3::Xxh3 ()
+{
+	const uint64_t init [8] = { PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1 };
+	std::memcpy (m_acc, init, sizeof (m_acc));
+}
+
+void Xxh3::ConsumeStripes (uint64_t acc [8], size_t & stripes_in_block, const unsigned char * data, size_t stripes) const noexcept
+{
+	for (; stripes > 0; stripes--, data += STRIPE_LEN)
+	{
+		Accumulate512 (acc, data, kSecret + stripes_in_block * SECRET_CONSUME_RATE);
+		if (++stripes_in_block == STRIPES_PER_BLOCK)
+		{
+			ScrambleAcc (acc, kSecret + sizeof (kSecret) - STRIPE_LEN);
+			stripes_in_block = 0;
+		}
+	}
+}
+
+void Xxh3::Update (const unsigned char * data, uintmax_t size) noexcept
+{
+	if (nullptr == data || m_bIsFinal)
+		return;
+
+	m_lLength += size;
+
+	if (m_buffered + size <= m_lBufferSize)
+	{
+		std::memcpy (m_buffer + m_buffered, data, static_cast <size_t> (size));
+		m_buffered += static_cast <size_t> (size);
+		return;
+	}
+
+	// more input follows the buffer, so all of it can be consumed
+	if (m_buffered > 0)
+	{
+		size_t part = m_lBufferSize - m_buffered;
+		std::memcpy (m_buffer + m_buffered, data, part);
+		data += part;
+		size -= part;
+
+		ConsumeStripes (m_acc, m_stripes_in_block, m_buffer, m_lBufferSize / STRIPE_LEN);
+		std::memcpy (m_last_stripe, m_buffer + m_lBufferSize - STRIPE_LEN, STRIPE_LEN);
+		m_buffered = 0;
+	}
+
+	// whole stripes straight from the input, leaving 1 to 256 bytes
+	if (size > m_lBufferSize)
+	{
+		uintmax_t stripes = (size - m_lBufferSize + STRIPE_LEN - 1) / STRIPE_LEN;
+		ConsumeStripes (m_acc, m_stripes_in_block, data, static_cast <size_t> (stripes));
+		data += stripes * STRIPE_LEN;
+		size -= stripes * STRIPE_LEN;
+		std::memcpy (m_last_stripe, data - STRIPE_LEN, STRIPE_LEN);
+	}
+
+	std::memcpy (m_buffer, data, static_cast <size_t> (size));
+	m_buffered = static_cast <size_t> (size);
+}
+
+void Xxh3::Finalize () noexcept
+{
+	if (m_bIsFinal)
+		return;
+	m_bIsFinal = true;
+
+	if (m_lLength <= MIDSIZE_MAX)
+	{
+		Hash128 h = HashShort (m_buffer, m_buffered);
+		m_hash_lo = h.lo;
+		m_hash_hi = h.hi;
+		return;
+	}
+
+	uint64_t acc [8];
+	std::memcpy (acc, m_acc, sizeof (acc));
+	size_t stripes_in_block = m_stripes_in_block;
+
+	// every stripe but the last one, which is taken as the last 64 bytes
+	// of the input, partly consumed already when the buffer is short
+	ConsumeStripes (acc, stripes_in_block, m_buffer, (m_buffered - 1) / STRIPE_LEN);
+
+	unsigned char last [STRIPE_LEN];
+	if (m_buffered >= STRIPE_LEN)
+	{
+		std::memcpy (last, m_buffer + m_buffered - STRIPE_LEN, STRIPE_LEN);
+	}
+	else
+	{
+		std::memcpy (last, m_last_stripe + m_buffered, STRIPE_LEN - m_buffered);
+		std::memcpy (last + STRIPE_LEN - m_buffered, m_buffer, m_buffered);
+	}
+	Accumulate512 (acc, last, kSecret + sizeof (kSecret) - STRIPE_LEN - 7);
+
+	m_hash_lo = MergeAccs (acc, kSecret + 11, m_lLength * PRIME64_1);
+	m_hash_hi = MergeAccs (acc, kSecret + sizeof (kSecret) - sizeof (acc) - 11, ~(m_lLength * PRIME64_2));
+}
+
+void Xxh3::GetDigest (unsigned char * buffer) const noexcept
+{
+	if (nullptr == buffer || !m_bIsFinal)
+		return;
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		buffer [i] = static_cast <unsigned char> (m_hash_hi >> (56 - i * 8));
+		buffer [8 + i] = static_cast <unsigned char> (m_hash_lo >> (56 - i * 8));
+	}
+}
@@ -0,0 +1,39 @@
+
+#pragma once
+#include "hasher.h"
+
+// XXH3-128 with the default secret and seed 0. Digests are in the canonical
+// big-endian form, so reports match what xxhsum -H2 prints
+class Xxh3 : public Hasher
+{
+public:
+	Xxh3 ();
+
+	void Update (const unsigned char * data, uintmax_t size) noexcept override;
+	void Finalize () noexcept override;
+
+	size_t GetDigestSize () const noexcept override { return m_lDigestSize; }
+	void GetDigest (unsigned char * buffer) const noexcept override;
+
+private:
+	static const size_t m_lBufferSize = 256;
+
+	void ConsumeStripes (uint64_t acc [8], size_t & stripes_in_block, const unsigned char * data, size_t stripes) const noexcept;
+
+private:
+	bool m_bIsFinal = false;
+	const size_t m_lDigestSize = 16;
+
+	uint64_t m_acc [8] = {};
+	size_t m_stripes_in_block = 0;
+	uint64_t m_lLength = 0;					// Message length in bytes
+
+	// input not consumed yet. Stripes are consumed only once more input
+	// follows them, the last one is hashed differently
+	unsigned char m_buffer [m_lBufferSize] = {};
+	size_t m_buffered = 0;
+	unsigned char m_last_stripe [64] = {};	// last 64 consumed bytes
+
+	uint64_t m_hash_lo = 0;
+	uint64_t m_hash_hi = 0;
+};
@@ -0,0 +1,417 @@
+
+#include "pch.h"
+#include "MaskSet.h"
+#include "DirEnum.h"
+#include <regex>
+#include <fstream>
+
+// Micro-benchmarks of the enumeration hot path, in ns per name. Masks are
+// timed as compiled GlobMask and MaskSet against the regex the scan used
+// to build from the mask on every match. A flat directory of many files is
+// scanned with and without include masks, and with the include verdict of
+// the parent checked again for every file, as the scan did before. Heap
+// allocations of the scan are counted per entry, excluded and reported
+
+// the mask as the scan translated it to a regex before masks were compiled,
+// '.' and '|' unescaped as they were
+static std::wstring OldRegex (const std::wstring & mask)
+{
+	std::wstring masked (L"^");
+	for (auto c : mask)
+	{
+		switch (c)
+		{
+		case L'*':
+			masked += L".*";
+			break;
+		case L'?':
+			masked += L'.';
+			break;
+
+		case L'(':
+		case L')':
+		case L'+':
+		case L'[':
+		case L']':
+		case L'{':
+		case L'}':
+		case L'\\':
+		case L'$':
+		case L'^':
+			masked += L'\\' + std::wstring (1, c);
+			break;
+
+		default:
+			masked += c;
+		}
+	}
+	masked += L'$';
+	return masked;
+}
+
+// a regex built per call, as the old MatchMask did for every entry
+static bool MatchOldRegex (const std::wstring & regex, const std::wstring & str)
+{
+	std::wregex r (regex, std::wregex::ECMAScript);
+	std::wsmatch m;
+	return std::regex_search (str, m, r);
+}
+
+// global operator new counts its calls while g_count_allocations is set
+static std::atomic <bool> g_count_allocations { false };
+static std::atomic <size_t> g_allocations { 0 };
+
+void * operator new (size_t size)
+{
+	if (g_count_allocations.load (std::memory_order_relaxed))
+		g_allocations.fetch_add (1, std::memory_order_relaxed);
+	void * p = std::malloc (0 == size ? 1 : size);
+	if (nullptr == p)
+		throw std::bad_alloc ();
+	return p;
+}
+
+void operator delete (void * p) noexcept
+{
+	std::free (p);
+}
+
+void operator delete (void * p, size_t) noexcept
+{
+	std::free (p);
+}
+
+static uint64_t Random (uint64_t & state) noexcept
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static std::vector <std::wstring> RandomNames (size_t count, uint64_t & state)
+{
+	static const wchar_t * stems [] = { L"report", L"Readme", L"main", L"build_log", L"IMG_", L"data", L"notes", L"setup" };
+	static const wchar_t * exts [] = { L".txt", L".log", L".cpp", L".h", L".JPG", L".dat", L".tmp", L"" };
+
+	std::vector <std::wstring> names;
+	for (size_t i = 0; i < count; i++)
+	{
+		std::wstring name = stems [Random (state) % std::size (stems)];
+		name += std::to_wstring (Random (state) % 100000);
+		name += exts [Random (state) % std::size (exts)];
+		names.push_back (std::move (name));
+	}
+	return names;
+}
+
+// ns per call of match over every name, best of a few passes
+template <class F>
+static double NsPerName (const std::vector <std::wstring> & names, size_t & matched, F && match)
+{
+	double best = 0;
+	for (int pass = 0; pass < 3; pass++)
+	{
+		matched = 0;
+		auto start = std::chrono::high_resolution_clock::now ();
+		for (auto & name : names)
+			matched += match (name) ? 1 : 0;
+		std::chrono::duration <double, std::nano> elapsed = std::chrono::high_resolution_clock::now () - start;
+		double ns = elapsed.count () / names.size ();
+		if (0 == pass || ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+static bool BenchMasks ()
+{
+	uint64_t state = 0x9e3779b97f4a7c15ull;
+	auto names = RandomNames (200000, state);
+	// the regex is slow enough for a tenth of the names
+	std::vector <std::wstring> regex_names (names.begin (), names.begin () + names.size () / 10);
+
+	static const std::list <std::wstring> cases [] =
+	{
+		{ L"*.log" },
+		{ L"report*" },
+		{ L"*log*1?.txt" },
+		{ L"*.txt", L"*.log", L"*.cpp", L"*.h", L"readme*", L"img_*", L"*_log*", L"setup?.dat" },
+	};
+
+	std::wcout << L"Masks over " << names.size () << L" names, ns per name\n";
+	bool ok = true;
+	for (auto & masks : cases)
+	{
+		std::wstring title;
+		std::vector <GlobMask> globs;
+		std::vector <std::wstring> regexes;
+		for (auto & mask : masks)
+		{
+			title += (title.empty () ? L"" : L" ") + mask;
+			globs.emplace_back (mask);
+			// the old scan lowercased masks and names before matching
+			std::wstring lower (mask);
+			std::transform (lower.begin (), lower.end (), lower.begin (), [](wchar_t c) { return std::towlower (c); });
+			regexes.push_back (OldRegex (lower));
+		}
+		MaskSet set;
+		set.Add (masks);
+
+		size_t by_regex = 0, by_glob = 0, by_set = 0, by_set_part = 0;
+		double regex_ns = NsPerName (regex_names, by_regex, [&regexes](const std::wstring & name)
+		{
+			std::wstring lower (name);
+			std::transform (lower.begin (), lower.end (), lower.begin (), [](wchar_t c) { return std::towlower (c); });
+			for (auto & regex : regexes)
+			{
+				if (MatchOldRegex (regex, lower))
+					return true;
+			}
+			return false;
+		});
+		double glob_ns = NsPerName (names, by_glob, [&globs](const std::wstring & name)
+		{
+			for (auto & glob : globs)
+			{
+				if (glob.Match (name))
+					return true;
+			}
+			return false;
+		});
+		double set_ns = NsPerName (names, by_set, [&set](const std::wstring & name) { return set.Match (name); });
+		NsPerName (regex_names, by_set_part, [&set](const std::wstring & name) { return set.Match (name); });
+
+		wprintf (L"  %-60ls regex %9.1f   GlobMask %7.1f   MaskSet %7.1f\n", title.c_str (), regex_ns, glob_ns, set_ns);
+		if (by_glob != by_set)
+		{
+			std::wcout << L"  GlobMask matched " << by_glob << L" names, MaskSet " << by_set << std::endl;
+			ok = false;
+		}
+		// the old regex let '.' match any symbol, so it may only match more
+		if (by_set_part > by_regex)
+		{
+			std::wcout << L"  regex matched " << by_regex << L" names, MaskSet " << by_set_part << std::endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+// counts found files, and checks the include masks of the file's directory
+// again for each of them if asked to
+struct CountingHandler : public IDirEnumHandler
+{
+	size_t files = 0;
+	const MaskSet * inc_dirs = nullptr;
+	const MaskSet * inc_paths = nullptr;
+
+	void OnGivenPathFail (const std::wstring & file, std::wstring error) override
+	{
+		std::wcout << L"  " << file << L": " << error << std::endl;
+	}
+
+	void OnFileFound (const std::filesystem::path & file, uintmax_t size) override
+	{
+		if (inc_dirs != nullptr)
+		{
+			std::filesystem::path parent (file.parent_path ());
+			if (!inc_paths->Match (parent.wstring ()) || !inc_dirs->Match (parent.filename ().wstring ()))
+				return;
+		}
+		files++;
+	}
+
+	void OnDirFound (const std::filesystem::path & dir) override
+	{
+	}
+
+	void OnScanError (const std::string & error) override
+	{
+		std::cout << "  " << error << std::endl;
+	}
+};
+
+// directory of count empty files, left in the temp directory to be reused
+// by the next run
+static std::filesystem::path WideDirectory (size_t count)
+{
+	std::filesystem::path dir (std::filesystem::temp_directory_path () / L"filesearch_bench" / L"wide");
+	if (std::filesystem::is_directory (dir))
+	{
+		size_t found = 0;
+		for (auto & entry : std::filesystem::directory_iterator (dir))
+			found += entry.is_regular_file () ? 1 : 0;
+		if (found == count)
+			return dir;
+		std::filesystem::remove_all (dir);
+	}
+
+	std::wcout << L"Creating " << count << L" files in " << dir.wstring () << std::endl;
+	std::filesystem::create_directories (dir);
+	uint64_t state = 0x2545f4914f6cdd1dull;
+	auto names = RandomNames (count, state);
+	for (size_t i = 0; i < count; i++)
+	{
+		std::ofstream file (dir / (std::to_wstring (i) + L"_" + names [i]));
+		if (!file)
+			throw std::runtime_error ("Can't create a file of the wide directory");
+	}
+	return dir;
+}
+
+static bool BenchWideDirectory ()
+{
+	static const size_t count = 100000;
+	auto dir = WideDirectory (count);
+	std::wstring dir_mask (dir.wstring () + L"*");
+
+	struct Case
+	{
+		const wchar_t * title;
+		bool masks;
+		bool recheck;
+	};
+	static const Case cases [] =
+	{
+		{ L"no masks", false, false },
+		{ L"-id wid* -ip <dir>*, verdict per directory", true, false },
+		{ L"-id wid* -ip <dir>*, verdict per file", true, true },
+	};
+
+	std::wcout << L"\nFlat directory of " << count << L" files, single thread, ns per file\n";
+	bool ok = true;
+	for (auto & c : cases)
+	{
+		ListOfStrings inc_dirs { L"wid*" };
+		ListOfStrings inc_paths { dir_mask };
+		MaskSet dirs_set, paths_set;
+		dirs_set.Add (inc_dirs);
+		paths_set.Add (inc_paths);
+
+		double best = 0;
+		size_t found = 0;
+		for (int pass = 0; pass < 7; pass++)
+		{
+			CountingHandler handler;
+			if (c.recheck)
+			{
+				handler.inc_dirs = &dirs_set;
+				handler.inc_paths = &paths_set;
+			}
+			DirEnumerator de (&handler);
+			de.SetScanDirectories ({ dir.wstring () });
+			de.SetSizeRequired (false);
+			if (c.masks)
+			{
+				de.AddIncludeDirectories (inc_dirs);
+				de.AddIncludePaths (inc_paths);
+			}
+
+			auto start = std::chrono::high_resolution_clock::now ();
+			de.EnumerateDirectory ();
+			std::chrono::duration <double, std::nano> elapsed = std::chrono::high_resolution_clock::now () - start;
+			double ns = elapsed.count () / count;
+			if (0 == pass || ns < best)
+				best = ns;
+			found = handler.files;
+		}
+
+		wprintf (L"  %-60ls %7.1f\n", c.title, best);
+		if (found != count)
+		{
+			std::wcout << L"  found " << found << L" files of " << count << std::endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+// heap allocations per entry of the scan of the wide directory, with every
+// file excluded by a mask and with every file reported. An excluded entry is
+// matched on views of a reused path buffer and allocates nothing, a reported
+// one costs the std::filesystem::path handed to the handler, counted here
+// for the same names. The Win7 backend gets a path from the
+// directory_iterator for every entry on top of that
+static bool BenchAllocations ()
+{
+	static const size_t count = 100000;
+	auto dir = WideDirectory (count);
+
+	// the backends append the native name to the directory path
+	std::vector <std::filesystem::path::string_type> names;
+	for (auto & entry : std::filesystem::directory_iterator (dir))
+		names.push_back (entry.path ().filename ().native ());
+
+	g_allocations = 0;
+	g_count_allocations = true;
+	for (auto & name : names)
+		std::filesystem::path file (dir / name.c_str ());
+	g_count_allocations = false;
+	double path_cost = static_cast <double> (g_allocations) / names.size ();
+
+#ifdef _WIN32
+	static const double backend_cost = 2;
+#else
+	static const double backend_cost = 0;
+#endif
+	const double excluded_budget = backend_cost + 0.05;
+	const double reported_budget = backend_cost + path_cost + 0.05;
+
+	struct Case
+	{
+		const wchar_t * title;
+		bool exclude;
+		double budget;
+	};
+	const Case cases [] =
+	{
+		{ L"-xf *, every file excluded", true, excluded_budget },
+		{ L"no masks, every file reported", false, reported_budget },
+	};
+
+	std::wcout << L"\nHeap allocations per entry of the flat directory, " << path_cost << L" per path of a file\n";
+	bool ok = true;
+	for (auto & c : cases)
+	{
+		CountingHandler handler;
+		DirEnumerator de (&handler);
+		de.SetScanDirectories ({ dir.wstring () });
+		de.SetSizeRequired (false);
+		if (c.exclude)
+		{
+			ListOfStrings all { L"*" };
+			de.AddExcludeFiles (all);
+		}
+
+		g_allocations = 0;
+		g_count_allocations = true;
+		de.EnumerateDirectory ();
+		g_count_allocations = false;
+
+		double per_entry = static_cast <double> (g_allocations) / count;
+		wprintf (L"  %-60ls %7.3f   budget %5.2f\n", c.title, per_entry, c.budget);
+		if (per_entry > c.budget || handler.files != (c.exclude ? 0 : count))
+		{
+			std::wcout << L"  " << handler.files << L" files reported, allocations over the budget" << std::endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int main ()
+{
+	bool ok = BenchMasks ();
+	try
+	{
+		ok = BenchWideDirectory () && ok;
+		ok = BenchAllocations () && ok;
+	}
+	catch (std::exception & ex)
+	{
+		std::wcout << L"Unexpected error occuped: " << ex.what () << std::endl;
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+
+#include "pch.h"
+#include "sha1.h"
+#include "sha1batch.h"
+
+// Checks every SHA-1 kernel the CPU supports against known answers and
+// against the scalar kernel on random lengths, then measures each in GB/s.
+// Returns non-zero if any kernel is wrong
+
+static const Sha1Kernel kernels [] = { Sha1Kernel::scalar, Sha1Kernel::ssse3, Sha1Kernel::avx2, Sha1Kernel::shani };
+static const Sha1LanesKernel lanes_kernels [] = { Sha1LanesKernel::sse2, Sha1LanesKernel::avx2, Sha1LanesKernel::avx512 };
+
+static std::wstring Widen (const char * text)
+{
+	return std::wstring (text, text + strlen (text));
+}
+
+static std::wstring Hex (const unsigned char * digest)
+{
+	return Digest::FromBytes (digest, Sha1Batch::m_lDigestSize).ToHex ();
+}
+
+// hashes data in pieces of piece bytes, to go through the buffering of Update
+static std::wstring HashSha1 (const unsigned char * data, size_t size, size_t piece = (size_t)-1)
+{
+	Sha1 sha1;
+	for (size_t pos = 0; pos < size; pos += piece)
+		sha1.Update (data + pos, std::min (piece, size - pos));
+	sha1.Finalize ();
+	return sha1.Result ().ToHex ();
+}
+
+static uint64_t Random (uint64_t & state) noexcept
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static std::vector <unsigned char> RandomBytes (size_t size, uint64_t & state)
+{
+	std::vector <unsigned char> data (size);
+	for (auto & b : data)
+		b = static_cast <unsigned char> (Random (state));
+	return data;
+}
+
+struct KnownAnswer
+{
+	std::string message;
+	const wchar_t * digest;
+};
+
+static bool CheckKnownAnswers (const std::wstring & kernel_name)
+{
+	static const KnownAnswer answers [] =
+	{
+		{ "", L"DA39A3EE5E6B4B0D3255BFEF95601890AFD80709" },
+		{ "abc", L"A9993E364706816ABA3E25717850C26C9CD0D89D" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", L"84983E441C3BD26EBAAE4AA1F95129E5E54670F1" },
+		{ std::string (1000000, 'a'), L"34AA973CD4C4DAA4F61EEB2BDBAD27316534016F" },
+	};
+
+	bool ok = true;
+	for (auto & answer : answers)
+	{
+		auto data = reinterpret_cast <const unsigned char *> (answer.message.data ());
+		for (size_t piece : { (size_t)-1, (size_t)1, (size_t)63, (size_t)1000 })
+		{
+			auto hash = HashSha1 (data, answer.message.size (), piece);
+			if (hash != answer.digest)
+			{
+				std::wcout << kernel_name << L": " << answer.message.size () << L" bytes in pieces of " << (intmax_t)piece
+					<< L": " << hash << L", expected " << answer.digest << std::endl;
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+int wmain (int argc, wchar_t * argv [])
+{
+	const size_t lengths = 2000;
+	uint64_t state = 0x9e3779b97f4a7c15ull;
+
+	// random messages and their digests by the scalar kernel
+	std::vector <std::vector <unsigned char>> messages;
+	for (size_t i = 0; i < lengths; i++)
+		messages.push_back (RandomBytes (i < 300 ? i : static_cast <size_t> (Random (state) % (64 * 1024)), state));
+
+	Sha1::SetKernel (Sha1Kernel::scalar);
+	std::vector <std::wstring> expected;
+	for (auto & message : messages)
+		expected.push_back (HashSha1 (message.data (), message.size ()));
+
+	bool ok = true;
+	auto Report = [&](const std::wstring & name, bool passed)
+	{
+		std::wcout << (passed ? L"ok     " : L"FAILED ") << name << std::endl;
+		ok = ok && passed;
+	};
+
+	for (auto kernel : kernels)
+	{
+		auto name = Widen (GetSha1KernelName (kernel));
+		if (!Sha1::SetKernel (kernel))
+		{
+			std::wcout << L"skip   " << name << std::endl;
+			continue;
+		}
+
+		bool passed = CheckKnownAnswers (name);
+		for (size_t i = 0; i < messages.size (); i++)
+		{
+			if (HashSha1 (messages [i].data (), messages [i].size (), 1 + Random (state) % 4096) != expected [i])
+			{
+				std::wcout << name << L": random message of " << messages [i].size () << L" bytes differs from scalar" << std::endl;
+				passed = false;
+				break;
+			}
+		}
+		Report (name, passed);
+	}
+	Sha1::SetKernel (SelectSha1Kernel ());
+
+	for (auto kernel : lanes_kernels)
+	{
+		auto name = Widen (GetSha1LanesKernelName (kernel)) + L" lanes";
+		if (!Sha1Batch::SetKernel (kernel))
+		{
+			std::wcout << L"skip   " << name << std::endl;
+			continue;
+		}
+
+		std::vector <unsigned char> digests (messages.size () * Sha1Batch::m_lDigestSize);
+		Sha1Batch batch;
+		for (size_t i = 0; i < messages.size (); i++)
+			batch.Add (messages [i].data (), messages [i].size (), digests.data () + i * Sha1Batch::m_lDigestSize);
+		batch.Run ();
+
+		bool passed = true;
+		for (size_t i = 0; i < messages.size (); i++)
+		{
+			if (Hex (digests.data () + i * Sha1Batch::m_lDigestSize) != expected [i])
+			{
+				std::wcout << L"message " << i << L" of " << messages [i].size () << L" bytes differs from scalar" << std::endl;
+				passed = false;
+				break;
+			}
+		}
+		Report (name, passed);
+	}
+
+	// throughput of the block kernels on 64 MB, of the lanes kernels on as
+	// many 1 MB messages as they have lanes
+	auto data = RandomBytes (64 * 1024 * 1024, state);
+	auto Measure = [](auto && run, size_t bytes)
+	{
+		run ();
+		auto start = std::chrono::high_resolution_clock::now ();
+		const int passes = 4;
+		for (int i = 0; i < passes; i++)
+			run ();
+		std::chrono::duration <double> elapsed = std::chrono::high_resolution_clock::now () - start;
+		return bytes * passes / elapsed.count () / 1e9;
+	};
+
+	for (auto kernel : kernels)
+	{
+		if (!IsSha1KernelSupported (kernel))
+			continue;
+		auto func = GetSha1BlockFunc (kernel);
+		double speed = Measure ([&]
+		{
+			uint32_t digest [5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+			func (digest, data.data (), data.size () / 64);
+		}, data.size ());
+		std::wcout << Widen (GetSha1KernelName (kernel)) << L": " << speed << L" GB/s" << std::endl;
+	}
+
+	for (auto kernel : lanes_kernels)
+	{
+		if (!Sha1Batch::SetKernel (kernel))
+			continue;
+		const size_t message_size = 1024 * 1024;
+		size_t count = GetSha1Lanes (kernel);
+		std::vector <unsigned char> digests (count * Sha1Batch::m_lDigestSize);
+		double speed = Measure ([&]
+		{
+			Sha1Batch batch;
+			for (size_t i = 0; i < count; i++)
+				batch.Add (data.data () + i * message_size, message_size, digests.data () + i * Sha1Batch::m_lDigestSize);
+			batch.Run ();
+		}, count * message_size);
+		std::wcout << Widen (GetSha1LanesKernelName (kernel)) << L" lanes: " << speed << L" GB/s" << std::endl;
+	}
+
+	return ok ? 0 : 1;
+}